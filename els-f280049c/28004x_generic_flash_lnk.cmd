@@ -89,9 +89,17 @@ PAGE 1 :
    RAMGS1      : origin = 0x00E000, length = 0x002000
    RAMGS2      : origin = 0x010000, length = 0x002000
    RAMGS3      : origin = 0x012000, length = 0x002000
+
+   CLA1_MSGRAMLOW  : origin = 0x001480, length = 0x000080
+   CLA1_MSGRAMHIGH : origin = 0x001500, length = 0x000080
 }
 
 
+/* CLA C compiler scratchpad, for the CLA stepper engine */
+CLA_SCRATCHPAD_SIZE = 0x100;
+--undef_sym=__cla_scratchpad_end
+--undef_sym=__cla_scratchpad_start
+
 SECTIONS
 {
    codestart        : > BEGIN,     PAGE = 0, ALIGN(4)
@@ -107,10 +115,18 @@ SECTIONS
    .esysmem         : > RAMLS5,    PAGE = 1   
    .econst          : > FLASH_BANK0_SEC4,    PAGE = 0, ALIGN(4)
 
+   /* stepper engine state, see main.cpp */
+   hotdata          : > RAMLS5,    PAGE = 1
+
    ramgs0           : > RAMGS0,    PAGE = 1
    ramgs1           : > RAMGS1,    PAGE = 1
 
-   .TI.ramfunc      : LOAD = FLASH_BANK0_SEC1,
+   /* Flash setup and the stepper ISR (hotfuncs) are copied to RAM at startup,
+      so the ISR runs without flash wait states.  The map file lists every
+      function in hotfuncs with its run address.  To time the ISR from flash
+      for comparison, move hotfuncs out of this group and into .text. */
+   .TI.ramfunc      : { *(.TI.ramfunc) *(hotfuncs) }
+                         LOAD = FLASH_BANK0_SEC1,
                          RUN = RAMLS0 | RAMLS1 | RAMLS2 |RAMLS3,
                          LOAD_START(_RamfuncsLoadStart),
                          LOAD_SIZE(_RamfuncsLoadSize),
@@ -120,5 +136,26 @@ SECTIONS
                          RUN_END(_RamfuncsRunEnd),
                          PAGE = 0, ALIGN(4)
 
+   /* CLA stepper engine: program in LS4, data in LS7 */
+   Cla1Prog         : LOAD = FLASH_BANK0_SEC5,
+                      RUN = RAMLS4,
+                      LOAD_START(_Cla1funcsLoadStart),
+                      LOAD_SIZE(_Cla1funcsLoadSize),
+                      RUN_START(_Cla1funcsRunStart),
+                      PAGE = 0, ALIGN(4)
+   .const_cla       : LOAD = FLASH_BANK0_SEC5,
+                      RUN = RAMLS7,
+                      LOAD_START(_Cla1ConstLoadStart),
+                      LOAD_SIZE(_Cla1ConstLoadSize),
+                      RUN_START(_Cla1ConstRunStart),
+                      PAGE = 1
+   .bss_cla         : > RAMLS7,    PAGE = 1
+   .scratchpad      : > RAMLS7,    PAGE = 1
+   CLAscratch       : { *.obj(CLAscratch)
+                        . += CLA_SCRATCHPAD_SIZE;
+                        *.obj(CLAscratch_end) } > RAMLS7, PAGE = 1
+
+   Cla1ToCpuMsgRAM  : > CLA1_MSGRAMLOW,   PAGE = 1
+   CpuToCla1MsgRAM  : > CLA1_MSGRAMHIGH,  PAGE = 1
 }
 
@@ -89,14 +89,22 @@ PAGE 1 :
    RAMGS1      : origin = 0x00E000, length = 0x002000
    RAMGS2      : origin = 0x010000, length = 0x002000
    RAMGS3      : origin = 0x012000, length = 0x002000
+
+   CLA1_MSGRAMLOW  : origin = 0x001480, length = 0x000080
+   CLA1_MSGRAMHIGH : origin = 0x001500, length = 0x000080
 }
 
 /*You can arrange the .text, .cinit, .const, .pinit, .switch and .econst to FLASH when RAM is filled up.*/
+/* CLA C compiler scratchpad, for the CLA stepper engine */
+CLA_SCRATCHPAD_SIZE = 0x100;
+--undef_sym=__cla_scratchpad_end
+--undef_sym=__cla_scratchpad_start
+
 SECTIONS
 {
    codestart        : > BEGIN,     PAGE = 0
-   .TI.ramfunc      : > RAMM0      PAGE = 0
-   .text            : >>RAMM0 | RAMLS0 | RAMLS1 | RAMLS2 | RAMLS3 | RAMLS4,   PAGE = 0
+   .TI.ramfunc      : { *(.TI.ramfunc) *(hotfuncs) } > RAMM0 | RAMLS0 | RAMLS1 | RAMLS2 | RAMLS3,   PAGE = 0
+   .text            : >>RAMM0 | RAMLS0 | RAMLS1 | RAMLS2 | RAMLS3,   PAGE = 0
    .cinit           : > RAMM0,     PAGE = 0
    .pinit           : > RAMM0,     PAGE = 0
    .switch          : > RAMM0,     PAGE = 0
@@ -108,7 +116,21 @@ SECTIONS
    .econst          : >> RAMLS5|RAMLS6,    PAGE = 1
    .esysmem         : > RAMLS5|RAMLS6,    PAGE = 1
 
+   hotdata          : > RAMLS5|RAMLS6,    PAGE = 1
+
    ramgs0           : > RAMGS0,    PAGE = 1
    ramgs1           : > RAMGS1,    PAGE = 1  
+
+   /* CLA stepper engine: program in LS4, data in LS7 */
+   Cla1Prog         : > RAMLS4,    PAGE = 0
+   .const_cla       : > RAMLS7,    PAGE = 1
+   .bss_cla         : > RAMLS7,    PAGE = 1
+   .scratchpad      : > RAMLS7,    PAGE = 1
+   CLAscratch       : { *.obj(CLAscratch)
+                        . += CLA_SCRATCHPAD_SIZE;
+                        *.obj(CLAscratch_end) } > RAMLS7, PAGE = 1
+
+   Cla1ToCpuMsgRAM  : > CLA1_MSGRAMLOW,   PAGE = 1
+   CpuToCla1MsgRAM  : > CLA1_MSGRAMHIGH,  PAGE = 1
 }
 
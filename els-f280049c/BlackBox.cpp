@@ -0,0 +1,254 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "BlackBox.h"
+
+
+BlackBox :: BlackBox(EEPROM *eeprom, Encoder *encoder, StepperDrive *stepperDrive, Core *core)
+{
+    this->eeprom = eeprom;
+    this->encoder = encoder;
+    this->stepperDrive = stepperDrive;
+    this->core = core;
+
+    for( Uint16 i=0; i < BLACKBOX_SAMPLES * BLACKBOX_SAMPLE_WORDS; i++ ) {
+        this->ring[i] = 0;
+    }
+    for( Uint16 i=0; i < EEPROM_PAGE_SIZE; i++ ) {
+        this->record.header.all[i] = 0;
+    }
+    for( Uint16 i=0; i < BLACKBOX_SLOT_WORDS; i++ ) {
+        this->record.samples[i] = 0;
+    }
+    this->next = 0;
+
+    this->sampleCycles = 0;
+    this->previousSpindlePosition = 0;
+    this->previousCarriagePosition = 0;
+
+    this->feedRow = 0;
+
+    this->frozen = false;
+    this->frozenNext = 0;
+    this->pagesWritten = 0;
+
+    this->nextSlot = 0;
+    this->sequence = 0;
+
+    this->alarmRecorded = false;
+}
+
+Uint16 BlackBox :: slotPage(Uint16 slot)
+{
+    return EEPROM_BLACKBOX_PAGE + slot * BLACKBOX_SLOT_PAGES;
+}
+
+Uint16 BlackBox :: ageSlot(Uint16 age)
+{
+    // records are written round the slots, newest just before nextSlot
+    return (this->nextSlot + BLACKBOX_SLOTS - 1 - age) % BLACKBOX_SLOTS;
+}
+
+Uint16 BlackBox :: calculateChecksum(BLACKBOX_HEADER *header)
+{
+    Uint16 sum = 0;
+
+    // everything but the checksum word itself
+    for( Uint16 i=0; i < EEPROM_PAGE_SIZE - 1; i++ ) {
+        sum += header->all[i];
+    }
+    return ~sum;
+}
+
+bool BlackBox :: readHeader(Uint16 slot, BLACKBOX_HEADER *header)
+{
+    return this->eeprom->readPage(slotPage(slot), header->all) &&
+            header->bit.signature == BLACKBOX_SIGNATURE &&
+            header->bit.checksum == calculateChecksum(header);
+}
+
+void BlackBox :: load(void)
+{
+    BLACKBOX_HEADER slotHeader;
+    bool found = false;
+
+    // the next record goes after the newest one
+    for( Uint16 slot=0; slot < BLACKBOX_SLOTS; slot++ ) {
+        if( readHeader(slot, &slotHeader) &&
+                (! found || (int16)(slotHeader.bit.sequence - this->sequence) > 0) ) {
+            this->sequence = slotHeader.bit.sequence;
+            this->nextSlot = (slot + 1) % BLACKBOX_SLOTS;
+            found = true;
+        }
+    }
+}
+
+void BlackBox :: freeze(Uint16 cause)
+{
+    if( this->frozen ) {
+        return;
+    }
+    this->frozen = true;
+    this->frozenNext = this->next;
+
+    for( Uint16 i=0; i < EEPROM_PAGE_SIZE; i++ ) {
+        this->header.all[i] = 0;
+    }
+    this->header.bit.signature = BLACKBOX_SIGNATURE;
+    this->header.bit.sequence = ++this->sequence;
+    this->header.bit.cause = cause;
+    this->header.bit.samples = BLACKBOX_SLOT_SAMPLES;
+    this->header.bit.carriageLow = this->previousCarriagePosition & 0xFFFF;
+    this->header.bit.carriageHigh = (Uint32)this->previousCarriagePosition >> 16;
+    this->header.bit.spindleLow = this->previousSpindlePosition & 0xFFFF;
+    this->header.bit.spindleHigh = this->previousSpindlePosition >> 16;
+    this->header.bit.checksum = calculateChecksum(&this->header);
+
+    this->pagesWritten = 0;
+}
+
+void BlackBox :: loop(void)
+{
+    // record each servo alarm once
+    if( core->isAlarmLatched() ) {
+        if( ! this->alarmRecorded ) {
+            freeze(BLACKBOX_SERVO_ALARM);
+            this->alarmRecorded = true;
+        }
+    }
+    else {
+        this->alarmRecorded = false;
+    }
+
+    if( ! this->frozen ) {
+        return;
+    }
+
+    // one page per pass: first invalidate the old header, then the samples,
+    // then the new header, so a record cut short is never taken as valid
+    Uint16 page[EEPROM_PAGE_SIZE];
+    Uint16 firstPage = slotPage(this->nextSlot);
+
+    if( this->pagesWritten == 0 ) {
+        for( Uint16 i=0; i < EEPROM_PAGE_SIZE; i++ ) {
+            page[i] = 0;
+        }
+        this->eeprom->writePage(firstPage, page);
+    }
+    else if( this->pagesWritten < BLACKBOX_SLOT_PAGES ) {
+        // the samples run on from page to page, starting with the oldest
+        // still in the ring that fits in the record
+        Uint16 word = (this->pagesWritten - 1) * EEPROM_PAGE_SIZE;
+
+        for( Uint16 i=0; i < EEPROM_PAGE_SIZE; i++, word++ ) {
+            if( word < BLACKBOX_SLOT_SAMPLES * BLACKBOX_SAMPLE_WORDS ) {
+                Uint16 sample = this->frozenNext - BLACKBOX_SLOT_SAMPLES + word / BLACKBOX_SAMPLE_WORDS;
+                page[i] = this->ring[(sample & (BLACKBOX_SAMPLES - 1)) * BLACKBOX_SAMPLE_WORDS +
+                                     word % BLACKBOX_SAMPLE_WORDS];
+            }
+            else {
+                page[i] = 0;
+            }
+        }
+        this->eeprom->writePage(firstPage + this->pagesWritten, page);
+    }
+    else {
+        this->eeprom->writePage(firstPage, this->header.all);
+        this->nextSlot = (this->nextSlot + 1) % BLACKBOX_SLOTS;
+
+        // start recording again from here
+        this->previousSpindlePosition = encoder->getPosition();
+        this->previousCarriagePosition = stepperDrive->getCarriagePosition();
+        this->frozen = false;
+        return;
+    }
+
+    this->pagesWritten++;
+}
+
+Uint16 BlackBox :: getCause(Uint16 age)
+{
+    BLACKBOX_HEADER slotHeader;
+
+    if( age >= BLACKBOX_SLOTS ) {
+        return BLACKBOX_NONE;
+    }
+
+    if( ! readHeader(ageSlot(age), &slotHeader) ) {
+        return BLACKBOX_NONE;
+    }
+    return slotHeader.bit.cause;
+}
+
+bool BlackBox :: readRecord(Uint16 age)
+{
+    if( age >= BLACKBOX_SLOTS ) {
+        return false;
+    }
+
+    Uint16 slot = ageSlot(age);
+    if( ! readHeader(slot, &this->record.header) ) {
+        return false;
+    }
+    for( Uint16 page=1; page < BLACKBOX_SLOT_PAGES; page++ ) {
+        if( ! this->eeprom->readPage(slotPage(slot) + page,
+                &this->record.samples[(page - 1) * EEPROM_PAGE_SIZE]) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int32 BlackBox :: getRecordCarriage(Uint16 sample)
+{
+    int32 position = (int32)(((Uint32)this->record.header.bit.carriageHigh << 16) |
+            this->record.header.bit.carriageLow);
+
+    // work back from the newest sample, taking off the steps of each
+    for( Uint16 i=0; i < sample && i < BLACKBOX_SLOT_SAMPLES; i++ ) {
+        position -= (int16)recordSample(i)[2] >> 8;
+    }
+    return position;
+}
+
+Uint32 BlackBox :: getRecordSpindle(Uint16 sample)
+{
+    int32 maxCount = encoder->getMaxCount();
+    int32 position = ((Uint32)this->record.header.bit.spindleHigh << 16) |
+            this->record.header.bit.spindleLow;
+
+    // the same for the spindle, wrapping the way the encoder does
+    for( Uint16 i=0; i < sample && i < BLACKBOX_SLOT_SAMPLES; i++ ) {
+        position -= (int16)recordSample(i)[0];
+        if( position < 0 ) {
+            position += maxCount;
+        }
+        else if( position >= maxCount ) {
+            position -= maxCount;
+        }
+    }
+    return position;
+}
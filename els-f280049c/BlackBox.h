@@ -0,0 +1,266 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __BLACKBOX_H
+#define __BLACKBOX_H
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "EEPROM.h"
+#include "Encoder.h"
+#include "StepperDrive.h"
+#include "Core.h"
+
+
+// Identifies a black box record written by this firmware; change it whenever
+// the layout of BLACKBOX_HEADER_BITS or the samples changes
+#define BLACKBOX_SIGNATURE 0xE161
+
+// BLACKBOX_HEADER_BITS.cause
+#define BLACKBOX_NONE 0
+#define BLACKBOX_STEP_BACKLOG 1     // the leadscrew fell too far behind
+#define BLACKBOX_SERVO_ALARM 2      // a servo drive raised its alarm
+
+// Each sample is BLACKBOX_SAMPLE_WORDS words, holding changes since the
+// sample before; the header holds where the spindle and carriage were at the
+// newest sample, so earlier positions are found by working back from there:
+//   0  spindle count delta, signed
+//   1  leadscrew backlog, desired less current steps, signed
+//   2  carriage step delta, signed, in bits 15-8; feed row in bits 7-3,
+//      BLACKBOX_FLAG_* in bits 2-0
+// The backlog saturates at 16 bits, far past MAX_BUFFERED_STEPS, and the
+// carriage can't step fast enough to fill 8 bits in one sample.
+#define BLACKBOX_SAMPLE_WORDS 3
+#define BLACKBOX_FLAG_POWER 1
+#define BLACKBOX_FLAG_ENGAGED (1<<1)
+#define BLACKBOX_FLAG_JOGGING (1<<2)
+
+// RAM history, in samples; a power of two
+#define BLACKBOX_SAMPLES 256
+
+// CPU cycles between samples
+#define BLACKBOX_PERIOD_CYCLES ((Uint32)(CPU_CLOCK_HZ / BLACKBOX_RATE_HZ))
+
+// EEPROM pages for each record: a header, then the samples packed end to end,
+// oldest first, so a sample can straddle two pages; the last page is padded
+// with zeros.  Record n (0 to BLACKBOX_SLOTS-1) starts at page
+// EEPROM_BLACKBOX_PAGE + n * BLACKBOX_SLOT_PAGES, and the newest record is the
+// valid one with the highest sequence number.
+#define BLACKBOX_SLOT_PAGES ((EEPROM_PAGES - EEPROM_BLACKBOX_PAGE) / BLACKBOX_SLOTS)
+#define BLACKBOX_SLOT_WORDS ((BLACKBOX_SLOT_PAGES - 1) * EEPROM_PAGE_SIZE)
+#define BLACKBOX_SLOT_SAMPLES (BLACKBOX_SLOT_WORDS / BLACKBOX_SAMPLE_WORDS)
+
+#if BLACKBOX_SLOT_SAMPLES < 4
+#error BLACKBOX_SLOTS is too many for this EEPROM; each record must hold at least 4 samples
+#endif
+#if BLACKBOX_SLOT_SAMPLES > 255
+#error BLACKBOX_SLOTS is too few for this EEPROM; a record can hold at most 255 samples
+#endif
+
+struct BLACKBOX_HEADER_BITS
+{
+    Uint16 signature;
+    Uint16 sequence;            // counts up with every record
+    Uint16 cause:8;
+    Uint16 samples:8;           // oldest first
+    Uint16 carriageLow;         // carriage position at the last sample
+    Uint16 carriageHigh;
+    Uint16 spindleLow;          // spindle count at the last sample
+    Uint16 spindleHigh;
+    Uint16 checksum;
+};
+
+typedef union BLACKBOX_HEADER
+{
+    Uint16 all[EEPROM_PAGE_SIZE];
+    struct BLACKBOX_HEADER_BITS bit;
+} BLACKBOX_HEADER;
+
+// A record read back from EEPROM, laid out as it is stored
+typedef struct BLACKBOX_RECORD
+{
+    BLACKBOX_HEADER header;
+    Uint16 samples[BLACKBOX_SLOT_WORDS];
+} BLACKBOX_RECORD;
+
+
+//
+// Fault black box
+//
+// The stepper ISR records a compact sample every 1/BLACKBOX_RATE_HZ, timed by
+// the cycle counter Debug runs on CPU timer 2, into a RAM ring.  When the leadscrew backs up or a servo alarm latches, the ring is
+// frozen and the most recent BLACKBOX_SLOT_SAMPLES are written to the next of
+// BLACKBOX_SLOTS records in EEPROM, one page per pass of the main loop, after
+// which recording starts again.  Until then the whole ring can be read with
+// the debugger.  readRecord() brings a saved record back into RAM, where the
+// panel steps through it and the debugger can read it as a BLACKBOX_RECORD.
+//
+class BlackBox
+{
+private:
+    EEPROM *eeprom;
+    Encoder *encoder;
+    StepperDrive *stepperDrive;
+    Core *core;
+
+    // ring of samples, and the index of the next one
+    Uint16 ring[BLACKBOX_SAMPLES * BLACKBOX_SAMPLE_WORDS];
+    Uint16 next;
+
+    // CPU cycle count at the last sample, and the spindle count and carriage
+    // position then
+    Uint32 sampleCycles;
+    Uint32 previousSpindlePosition;
+    int32 previousCarriagePosition;
+
+    // feed row to record, from the user interface
+    Uint16 feedRow;
+
+    // is the ring frozen for a record, and how far has it been written?
+    bool frozen;
+    BLACKBOX_HEADER header;
+    Uint16 frozenNext;
+    Uint16 pagesWritten;
+
+    // where the next record goes
+    Uint16 nextSlot;
+    Uint16 sequence;
+
+    // has the current servo alarm been recorded?
+    bool alarmRecorded;
+
+    // the last record read back from EEPROM
+    BLACKBOX_RECORD record;
+
+    void sample(void);
+    Uint16 slotPage(Uint16 slot);
+    Uint16 ageSlot(Uint16 age);
+    Uint16 *recordSample(Uint16 sample);
+    bool readHeader(Uint16 slot, BLACKBOX_HEADER *header);
+    Uint16 calculateChecksum(BLACKBOX_HEADER *header);
+
+public:
+    BlackBox(EEPROM *eeprom, Encoder *encoder, StepperDrive *stepperDrive, Core *core);
+
+    // find where the next record goes; call once the EEPROM is up
+    void load(void);
+
+    // freeze the history and save it as a record of the given cause; ignored
+    // while the last record is still being written
+    void freeze(Uint16 cause);
+
+    // watch for a servo alarm and write any frozen record; call from the
+    // main loop
+    void loop(void);
+
+    void setFeedRow(Uint16 feedRow);
+
+    // cause of the n-th most recent record, counting from 0, or BLACKBOX_NONE
+    Uint16 getCause(Uint16 age);
+
+    // read the n-th most recent record into RAM; false if there isn't one
+    bool readRecord(Uint16 age);
+
+    // the record last read, at a sample counting back from the newest at 0:
+    // the leadscrew backlog, desired less current steps, and the carriage
+    // position and spindle count
+    int16 getRecordBacklog(Uint16 sample);
+    int32 getRecordCarriage(Uint16 sample);
+    Uint32 getRecordSpindle(Uint16 sample);
+
+    void ISR(void);
+};
+
+inline void BlackBox :: setFeedRow(Uint16 feedRow)
+{
+    this->feedRow = feedRow;
+}
+
+inline Uint16 *BlackBox :: recordSample(Uint16 sample)
+{
+    return &this->record.samples[(BLACKBOX_SLOT_SAMPLES - 1 - sample) * BLACKBOX_SAMPLE_WORDS];
+}
+
+inline int16 BlackBox :: getRecordBacklog(Uint16 sample)
+{
+    return (int16)recordSample(sample)[1];
+}
+
+#pragma CODE_SECTION("hotfuncs")
+inline void BlackBox :: ISR(void)
+{
+    // sample against the free-running CPU timer 2 rather than counting ISR
+    // passes, so the rate holds whatever the stepper interrupt runs at
+    Uint32 now = 0xFFFFFFFF - CpuTimer2Regs.TIM.all;
+    if( now - this->sampleCycles >= BLACKBOX_PERIOD_CYCLES ) {
+        this->sampleCycles += BLACKBOX_PERIOD_CYCLES;
+        if( now - this->sampleCycles >= BLACKBOX_PERIOD_CYCLES ) {
+            // fell more than a sample behind; start counting again from now
+            this->sampleCycles = now;
+        }
+        if( ! this->frozen ) {
+            sample();
+        }
+    }
+}
+
+#pragma CODE_SECTION("hotfuncs")
+inline void BlackBox :: sample(void)
+{
+    Uint32 spindlePosition = encoder->getPosition();
+    Uint32 maxCount = encoder->getMaxCount();
+    int32 delta = (int32)spindlePosition - (int32)previousSpindlePosition;
+    int32 backlog = stepperDrive->getDesiredPosition() - stepperDrive->getCurrentPosition();
+    int32 carriagePosition = stepperDrive->getCarriagePosition();
+    int16 steps = carriagePosition - previousCarriagePosition;
+    Uint16 flags = 0;
+
+    // take the short way around the encoder wrap
+    if( delta > (int32)(maxCount/2) ) {
+        delta -= maxCount;
+    }
+    else if( delta < -(int32)(maxCount/2) ) {
+        delta += maxCount;
+    }
+    if( backlog > 32767 ) backlog = 32767;
+    if( backlog < -32767 ) backlog = -32767;
+
+    if( core->isPowerOn() ) flags |= BLACKBOX_FLAG_POWER;
+    if( core->isEngaged() ) flags |= BLACKBOX_FLAG_ENGAGED;
+    if( core->isJogging() ) flags |= BLACKBOX_FLAG_JOGGING;
+
+    Uint16 *slot = &this->ring[(this->next & (BLACKBOX_SAMPLES - 1)) * BLACKBOX_SAMPLE_WORDS];
+    slot[0] = (int16)delta;
+    slot[1] = (int16)backlog;
+    slot[2] = ((steps & 0xFF) << 8) | ((this->feedRow & 0x1F) << 3) | flags;
+    this->next++;
+
+    this->previousSpindlePosition = spindlePosition;
+    this->previousCarriagePosition = carriagePosition;
+}
+
+
+#endif // __BLACKBOX_H
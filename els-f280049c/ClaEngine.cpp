@@ -0,0 +1,109 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "ClaEngine.h"
+#include <string.h>
+
+
+//
+// Message RAM shared with the CLA
+//
+#pragma DATA_SECTION(claInputs, "CpuToCla1MsgRAM")
+CLA_ENGINE_INPUTS claInputs;
+
+#pragma DATA_SECTION(claOutputs, "Cla1ToCpuMsgRAM")
+CLA_ENGINE_OUTPUTS claOutputs;
+
+//
+// CLA program and constants, copied from flash to CLA RAM at startup.  These
+// symbols are created by the linker.
+//
+extern "C" {
+extern Uint16 Cla1funcsLoadStart;
+extern Uint16 Cla1funcsLoadSize;
+extern Uint16 Cla1funcsRunStart;
+extern Uint16 Cla1ConstLoadStart;
+extern Uint16 Cla1ConstLoadSize;
+extern Uint16 Cla1ConstRunStart;
+}
+
+
+ClaEngine :: ClaEngine(StepperDrive *stepperDrive)
+{
+    this->stepperDrive = stepperDrive;
+}
+
+void ClaEngine :: initHardware(void)
+{
+    EALLOW;
+
+    //
+    // Clear the message RAMs
+    //
+    MemCfgRegs.MSGxINIT.bit.INIT_CLA1TOCPU = 1;
+    while( MemCfgRegs.MSGxINITDONE.bit.INITDONE_CLA1TOCPU != 1 ) {}
+    MemCfgRegs.MSGxINIT.bit.INIT_CPUTOCLA1 = 1;
+    while( MemCfgRegs.MSGxINITDONE.bit.INITDONE_CPUTOCLA1 != 1 ) {}
+
+#ifdef _FLASH
+    //
+    // Copy the CLA program and constants while the CPU still owns the RAM
+    //
+    memcpy(&Cla1funcsRunStart, &Cla1funcsLoadStart, (size_t)&Cla1funcsLoadSize);
+    memcpy(&Cla1ConstRunStart, &Cla1ConstLoadStart, (size_t)&Cla1ConstLoadSize);
+#endif
+
+    //
+    // LS4 holds the CLA program, LS7 the CLA data
+    //
+    MemCfgRegs.LSxMSEL.bit.MSEL_LS4 = 1;
+    MemCfgRegs.LSxCLAPGM.bit.CLAPGM_LS4 = 1;
+    MemCfgRegs.LSxMSEL.bit.MSEL_LS7 = 1;
+    MemCfgRegs.LSxCLAPGM.bit.CLAPGM_LS7 = 0;
+
+    //
+    // Task vectors; task 1 runs the engine and task 8 initializes it
+    //
+    Cla1Regs.MVECT1 = (Uint16)((Uint32)&Cla1Task1);
+    Cla1Regs.MVECT8 = (Uint16)((Uint32)&Cla1Task8);
+    Cla1Regs.MCTL.bit.IACKE = 1;
+    Cla1Regs.MIER.all = M_INT1 | M_INT8;
+
+    EDIS;
+
+    //
+    // Start in sync with the spindle; the drive stays disabled until Core
+    // passes down the feed
+    //
+    Cla1ForceTask8andWait();
+
+    //
+    // Run the engine from CPU timer 0
+    //
+    EALLOW;
+    DmaClaSrcSelRegs.CLA1TASKSRCSEL1.bit.TASK1 = CLA_TRIG_TINT0;
+    EDIS;
+}
@@ -0,0 +1,88 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __CLAENGINE_H
+#define __CLAENGINE_H
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "ClaShared.h"
+#include "StepperDrive.h"
+
+
+//
+// Main CPU side of the CLA stepper engine
+//
+// Sets up the CLA to run the engine from CPU timer 0, and passes the feed ratio
+// and enable state to it through message RAM.  The StepperDrive still owns the
+// pins and the enable output; only its ISR is replaced.
+//
+class ClaEngine
+{
+private:
+    StepperDrive *stepperDrive;
+
+public:
+    ClaEngine(StepperDrive *stepperDrive);
+    void initHardware(void);
+
+    void setRatio(float ratio);
+    void setEnabled(bool enabled);
+
+    int32 getCarriagePosition(void);
+    bool checkStepBacklog(void);
+};
+
+inline void ClaEngine :: setRatio(float ratio)
+{
+    claInputs.ratio = ratio;
+    claInputs.resyncRequest++;
+}
+
+inline void ClaEngine :: setEnabled(bool enabled)
+{
+    claInputs.enabled = enabled;
+    this->stepperDrive->setEnabled(enabled);
+}
+
+inline int32 ClaEngine :: getCarriagePosition(void)
+{
+    return claOutputs.carriagePosition;
+}
+
+inline bool ClaEngine :: checkStepBacklog(void)
+{
+    int32 backlog = claOutputs.desiredPosition - claOutputs.currentPosition;
+
+    if( backlog > MAX_BUFFERED_STEPS || backlog < -MAX_BUFFERED_STEPS ) {
+        setEnabled(false);
+        return true;
+    }
+    return false;
+}
+
+
+#endif // __CLAENGINE_H
@@ -0,0 +1,95 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __CLASHARED_H
+#define __CLASHARED_H
+
+//
+// Data shared between the main CPU and the CLA stepper engine
+//
+// Plain C, since the CLA compiler does not accept C++.  Only fixed-width types
+// are used here, because int is 16 bits on the C28x and 32 bits on the CLA.
+// 32-bit fields come first so the layout is the same on both.
+//
+
+#include "f28004x_cla_typedefs.h"
+#include "f28004x_device.h"
+#include "Configuration.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+//
+// Written by the CPU, read by the CLA (CpuToCla1MsgRAM)
+//
+typedef struct CLA_ENGINE_INPUTS
+{
+    // leadscrew steps per encoder count, including the feed direction
+    float ratio;
+
+    // drive enabled?
+    Uint16 enabled;
+
+    // bumped by the CPU to resync the drive to the spindle without stepping,
+    // after a feed or direction change
+    Uint16 resyncRequest;
+} CLA_ENGINE_INPUTS;
+
+//
+// Written by the CLA, read by the CPU (Cla1ToCpuMsgRAM)
+//
+typedef struct CLA_ENGINE_OUTPUTS
+{
+    int32 currentPosition;
+    int32 desiredPosition;
+    int32 carriagePosition;
+
+    // last resyncRequest serviced
+    Uint16 resyncDone;
+} CLA_ENGINE_OUTPUTS;
+
+
+extern CLA_ENGINE_INPUTS claInputs;
+extern CLA_ENGINE_OUTPUTS claOutputs;
+
+
+//
+// CLA tasks
+//
+// Task 1 is the stepper engine, triggered by CPU timer 0 every STEPPER_CYCLE_US.
+// Task 8 initializes the engine's private state, and is forced once at startup.
+//
+__interrupt void Cla1Task1(void);
+__interrupt void Cla1Task8(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CLASHARED_H
@@ -46,6 +46,20 @@
 // Example: 200hmm = 2mm
 #define LEADSCREW_HMM 300
 
+// Leadscrew pitch error compensation
+// Measure the carriage against a reference along the bed and enter the error,
+// in steps, at carriage positions PITCH_COMP_ORIGIN, PITCH_COMP_ORIGIN +
+// 2^PITCH_COMP_SHIFT, and so on, up to 32 points.  The ELS interpolates
+// between points and adds the correction to the leadscrew as the carriage
+// moves.  Positions count from where the carriage was at power-on, so power on
+// at the same reference.  The ELS stores the table in EEPROM, so it stays
+// with the machine, and picks up a new table here the first time it boots
+// after the firmware is rebuilt with it.
+//#define USE_PITCH_COMPENSATION
+#define PITCH_COMP_ORIGIN 0
+#define PITCH_COMP_SHIFT 12
+#define PITCH_COMP_TABLE { 0 }
+
 
 
 
@@ -78,9 +92,93 @@
 #define INVERT_ENABLE_PIN true
 #define INVERT_ALARM_PIN true
 
+// Step and direction timing, in microseconds, from the drive's datasheet
+// Minimum time the step signal must be high and low, how long direction must
+// be set before a step, and how long it must be held after the step edge.
+// Each is rounded up to whole STEPPER_CYCLE_US, and a step is always high for
+// at least one cycle and low for at least one.  Longer times lower the
+// maximum step rate.  Set STEPPER_DIR_SETUP_US to 0 for a drive that takes
+// direction with the step edge: the first step after a reversal then goes
+// out in the same cycle as the direction change.
+#define STEPPER_STEP_HIGH_US 5
+#define STEPPER_STEP_LOW_US 5
+#define STEPPER_DIR_SETUP_US 5
+#define STEPPER_DIR_HOLD_US 5
+
 // Enable servo alarm feedback
 #define USE_ALARM_PIN
 
+// Latch servo alarms
+// When a drive raises its alarm, the ELS stops stepping at once, records where
+// the carriage was commanded to be and the spindle angle at that moment, and
+// holds the alarm on the display.  Once the drive has been reset, stop the
+// spindle and press POWER: the carriage jogs back onto the recorded thread
+// phase and the ELS carries on.
+//#define USE_ALARM_LATCH
+
+// Backlash compensation
+// When the leadscrew changes direction, the ELS outputs this many extra steps
+// to take up the slack in the leadscrew, half-nut and gear train before the
+// carriage starts moving.  To adjust it on the machine, press SET until
+// BACKLASH is shown; UP and DOWN then change it, and it is saved to EEPROM
+// when SET moves on to the next display, so it stays with the machine.  A new
+// value here replaces the saved one the first time the ELS boots after the
+// firmware is rebuilt with it.  Take-up steps are output no faster than
+// BACKLASH_TAKEUP_RATE_HZ.
+#define BACKLASH_STEPS 0
+#define BACKLASH_TAKEUP_RATE_HZ 10000
+
+// Deceleration when approaching a stop, in steps per second squared
+// The ELS slows the leadscrew over the last few steps before a stop, so
+// the motor does not stall when it stops at full feed rate.
+#define STOP_DECELERATION 1000000
+
+// Jog rates and acceleration, in steps per second and steps per second squared
+// The ELS uses these to drive the carriage without the spindle, for example
+// to return to the start of a thread.  A jog starts and finishes at
+// JOG_MIN_RATE_HZ, which must be slow enough for the motor to start from rest.
+#define JOG_MIN_RATE_HZ 1000
+#define JOG_MAX_RATE_HZ 20000
+#define JOG_ACCELERATION 100000
+
+
+
+
+//================================================================================
+//                              CROSS SLIDE
+//
+// Optional second stepper on the cross slide (X axis), slaved to the spindle
+// alongside the leadscrew.  It uses GPIO4 (step), GPIO5 (direction), GPIO8
+// (enable) and GPIO9 (alarm).
+//
+// With X_TAPER_NUMERATOR set to zero, the cross slide takes the selected feed
+// and the leadscrew holds still, for power facing.  Otherwise, the cross slide
+// moves X_TAPER_NUMERATOR/X_TAPER_DENOMINATOR as far as the carriage, for
+// cutting tapers.  Example: 1/20 cuts a 1:10 taper on the diameter.
+//================================================================================
+
+// Enable the cross slide axis
+//#define USE_X_AXIS
+
+// Cross slide leadscrew pitch: define X_LEADSCREW_TPI or X_LEADSCREW_HMM
+//#define X_LEADSCREW_TPI 10
+#define X_LEADSCREW_HMM 200
+
+// Steps and microsteps
+#define X_STEPPER_MICROSTEPS 8
+#define X_STEPPER_RESOLUTION 200
+
+// Pin polarity, as for the leadscrew
+// #define X_INVERT_STEP_PIN true
+// #define X_INVERT_DIRECTION_PIN true
+#define X_INVERT_ENABLE_PIN true
+#define X_INVERT_ALARM_PIN true
+//#define X_USE_ALARM_PIN
+
+// Cross slide travel per unit of carriage travel, or zero for power facing
+#define X_TAPER_NUMERATOR 0
+#define X_TAPER_DENOMINATOR 1
+
 
 
 
@@ -98,11 +196,38 @@
 // Encoder resolution (counts per revolution)
 #define ENCODER_RESOLUTION 8192
 
+// Encoder index output
+// Define this if the encoder has an index (Z) output wired to the index
+// input.  The threading cycle and dividing head need it, and the encoder
+// monitor checks it; without it, the index input is gated off so a floating
+// pin can not be mistaken for an index pulse.
+//#define ENCODER_HAS_INDEX
+
+// Spindle standstill deadband, in encoder counts
+// A stopped spindle can dither back and forth by a count or two, which would
+// make the leadscrew chatter back and forth with it.  The ELS ignores a change
+// of direction until the spindle has moved more than this many counts back,
+// then catches up exactly, so the thread stays in phase.  0 follows every
+// count; 1 or 2 is enough for most encoders that dither.  Not used by the CLA
+// engine.
+#define SPINDLE_DEADBAND_COUNTS 0
+
 // Which encoder input to use
 #define ENCODER_USE_EQEP1
 //#define ENCODER_USE_EQEP2
 
 
+// Manual pulse generator (handwheel) on the spare eQEP
+// The handwheel drives the carriage when the spindle is stopped, and shifts
+// the thread phase while threading, for picking up an existing thread.  It
+// reads EQEP2 (GPIO14/15) when the spindle encoder is on EQEP1, and EQEP1
+// (GPIO35/37) otherwise.  Ground GPIO10 for x10 or GPIO11 for x100 steps per
+// detent.  MPG_DETENT_SHIFT sets the counts per detent as a power of two
+// (2 = 4 counts per detent).  Not used by the CLA engine.
+//#define USE_MPG
+#define MPG_DETENT_SHIFT 2
+#define MPG_MAX_RATE_HZ 5000
+
 
 
 //================================================================================
@@ -115,6 +240,13 @@
 // Use floating-point math for gear ratios
 #define USE_FLOATING_POINT
 
+// Run the stepper engine on the Control Law Accelerator instead of the main CPU
+// The CLA follows the spindle and drives the step and direction pins on its
+// own, which leaves the main CPU free.  The CLA engine only feeds and threads;
+// backlash compensation, stops, jogging and the threading cycle need the main
+// CPU engine.
+//#define USE_CLA_ENGINE
+
 
 
 
@@ -143,6 +275,24 @@
 // and direction keys are ignored.
 //#define IGNORE_ALL_KEYS_WHEN_RUNNING
 
+// Save the machine state when the supply fails
+// The ELS watches the supply on ADCINB1, and when it drops below
+// BROWNOUT_THRESHOLD (in ADC counts; about 1975 is normal), it turns the
+// drives off and saves the feed, mode, direction, carriage position and stop
+// to EEPROM before it loses power.  At the next power-up it picks up from
+// there.  Not used by the CLA engine.
+//#define USE_BROWNOUT_SNAPSHOT
+#define BROWNOUT_THRESHOLD 1750
+
+// Semi-automatic threading cycle
+// In thread mode, with a stop set and the spindle stopped, the ELS takes the
+// carriage position as the start of the thread.  Each pass engages at the
+// spindle encoder index pulse, feeds to the stop and parks there.  Retract the
+// tool and reverse the spindle to return to the start, or stop the spindle and
+// press FWD/REV to jog back, and the next pass will pick up the same thread.
+// Requires ENCODER_HAS_INDEX.
+//#define USE_THREADING_CYCLE
+
 
 
 
@@ -152,12 +302,61 @@
 // Validation thresholds and automatic trip behavior.
 //================================================================================
 
+// Stall supervisor
+// The ELS checks SUPERVISOR_RATE_HZ times a second that the stepper interrupt
+// and the user interface are both still running, and feeds the hardware
+// watchdog only if they are.  If the user interface makes no progress for
+// SUPERVISOR_LOOP_TIMEOUT_MS, or the stepper interrupt stops, the drives are
+// turned off, the fault is recorded in EEPROM and the ELS restarts and shows
+// the cause.
+//#define USE_SUPERVISOR
+#define SUPERVISOR_RATE_HZ 50
+#define SUPERVISOR_LOOP_TIMEOUT_MS 500
+
+// Fault black box
+// The ELS keeps a short history of the spindle and leadscrew, sampled
+// BLACKBOX_RATE_HZ times a second, and saves the end of it to EEPROM when the
+// leadscrew backs up or a servo alarm trips.  The last BLACKBOX_SLOTS faults
+// are kept.  To review them, turn the power off, stop the spindle and hold
+// SET; UP and DOWN step through the faults, newest first, and SET leaves.
+// FWD/REV opens the samples of the fault shown: UP and DOWN step back and
+// forward through them, showing the leadscrew backlog (desired less current
+// steps) at each, and FWD/REV goes back.  The record, with the spindle and
+// carriage movement and the feed row at each sample, is also left in RAM in
+// blackBox.record, laid out as described in BlackBox.h.  A record holds about
+// 70 samples on BoostXL v2 and 30 on v1, more with fewer BLACKBOX_SLOTS.
+#define USE_BLACKBOX
+#define BLACKBOX_RATE_HZ 1000
+#define BLACKBOX_SLOTS 2
+
 // Maximum number of buffered steps
 // The ELS can only output steps at approximately 100KHz.  If you ask the ELS to
 // output steps faster than this, it will get behind and will stop automatically
 // when the buffered step count exceeds this value.
 #define MAX_BUFFERED_STEPS 100
 
+// Monitor the spindle encoder signal
+// The ELS checks, in the background, that every index pulse arrives a whole
+// revolution of counts after the last one (within ENCODER_INDEX_TOLERANCE),
+// and watches for quadrature phase errors and for direction changes while the
+// spindle is turning faster than ENCODER_DIRECTION_RPM.  Any error is shown
+// on the display as ENC ERR, followed by the index, phase and direction error
+// counts.  The index is only checked with ENCODER_HAS_INDEX.
+//#define USE_ENCODER_MONITOR
+#define ENCODER_INDEX_TOLERANCE 2
+#define ENCODER_DIRECTION_RPM 30
+
+// Dividing head
+// Use the spindle as an indexer.  Press SET until DIVIDE is shown; UP and DOWN
+// then set the number of divisions, up to DIVIDING_MAX, instead of the feed.
+// The left display shows the division the spindle is nearest, counting from 1
+// at the index pulse, and the right display shows how far past (positive) or
+// short (negative) of it the spindle is, in tenths of a degree.  Dashes are
+// shown until the index pulse has been seen.  Requires ENCODER_HAS_INDEX.
+//#define USE_DIVIDING_HEAD
+#define DIVIDING_MAX 360
+#define DIVIDING_DEFAULT 6
+
 
 //================================================================================
 //                               CPU / TIMING
@@ -170,9 +369,35 @@
 // Two cycles are required per step
 #define STEPPER_CYCLE_US 5
 
+// Slow the stepper interrupt while idle
+// Once the spindle has been stopped and every drive at rest for
+// STEPPER_IDLE_DELAY_MS, the stepper interrupt runs every STEPPER_IDLE_CYCLE_US
+// instead, leaving most of the CPU to the user interface.  The first encoder
+// count or step puts it back to full rate.  The black box keeps its rate, as
+// it samples on CPU time.  Not supported by the CLA engine.
+//#define USE_IDLE_RATE
+#define STEPPER_IDLE_CYCLE_US 50
+#define STEPPER_IDLE_DELAY_MS 100
+
 // User interface refresh rate, in Hertz
 #define UI_REFRESH_RATE_HZ 100
 
+// Key scan rate, in Hertz, and how long a key must settle, in milliseconds
+// The keys are scanned from a timer interrupt, independent of the user
+// interface loop.  Each scan takes about half a millisecond of bus time.
+#define KEY_SCAN_RATE_HZ 200
+#define KEY_DEBOUNCE_MS 15
+
+// Auto-repeat for UP and DOWN
+// After KEY_REPEAT_DELAY_MS, a held key repeats every KEY_REPEAT_INTERVAL_MS.
+// Every KEY_REPEAT_ACCELERATION repeats, each repeat moves one more row, up to
+// KEY_REPEAT_MAX_COUNT rows; set KEY_REPEAT_ACCELERATION to 0 to always move
+// one row.
+#define KEY_REPEAT_DELAY_MS 500
+#define KEY_REPEAT_INTERVAL_MS 100
+#define KEY_REPEAT_ACCELERATION 10
+#define KEY_REPEAT_MAX_COUNT 4
+
 // RPM recalculation rate, in Hz
 #define RPM_CALC_RATE_HZ 2
 
@@ -32,8 +32,15 @@
 // Time delay after sending read command, before clocking in data
 #define DELAY_BEFORE_READING_US 3
 
-// Number of times a key state must be read consecutively to be considered stable
-#define MIN_CONSECUTIVE_READS 3
+// Key scan timer period, counting EPWMCLK (SYSCLK/2 out of reset) divided by 64
+#define KEY_SCAN_PERIOD (CPU_CLOCK_MHZ * 1000000L / 2 / 64 / KEY_SCAN_RATE_HZ)
+
+// Net scans a key must read pressed, or released, to change state
+#define KEY_DEBOUNCE_SCANS (KEY_DEBOUNCE_MS * KEY_SCAN_RATE_HZ / 1000)
+
+
+// Segment patterns for each decimal digit
+static const Uint16 DIGIT_GLYPHS[10] = { ZERO, ONE, TWO, THREE, FOUR, FIVE, SIX, SEVEN, EIGHT, NINE };
 
 
 // Lower the TM1638 CS (STB) line
@@ -48,13 +55,29 @@ ControlPanel :: ControlPanel(SPIBus *spiBus)
     this->spiBus = spiBus;
     this->rpm = 0;
     this->sposition = 0;
+    this->carriagePosition = 0;
+    this->carriageDecimals = 0;
+    this->division = 0;
+    this->divisionError = 0;
+    this->backlash = 0;
     this->value = NULL;
     this->leds.all = 0;
     this->keys.all = 0;
-    this->stableKeys.all = 0;
-    this->stableCount = 0;
+    for( int i=0; i < 8; i++ ) {
+        this->integrator[i] = 0;
+    }
+    this->scanTime = 0;
+    this->repeatKey = 0;
+    this->repeatTime = 0;
+    this->repeatCount = 0;
+    this->queueHead = 0;
+    this->queueTail = 0;
     this->message = NULL;
     this->brightness = 3;
+    this->rendered = false;
+    this->renderedMode = DISPLAY_RPM;
+    this->renderedValue = 0;
+    this->renderedDecimals = 0;
 }
 
 void ControlPanel :: initHardware(void)
@@ -67,6 +90,24 @@ void ControlPanel :: initHardware(void)
     CS_RELEASE;                                 // set it to high
 
     EDIS;
+
+    initScanTimer();
+}
+
+void ControlPanel :: initScanTimer(void)
+{
+    // ePWM8 only keeps time: count up and interrupt at every period
+    EPwm8Regs.TBCTL.bit.CTRMODE = 3;            // stopped while it is set up
+    EPwm8Regs.TBCTL.bit.HSPCLKDIV = 0;          // /1
+    EPwm8Regs.TBCTL.bit.CLKDIV = 6;             // /64
+    EPwm8Regs.TBPRD = KEY_SCAN_PERIOD - 1;
+    EPwm8Regs.TBCTR = 0;
+
+    EPwm8Regs.ETSEL.bit.INTSEL = 1;             // interrupt when the counter is zero
+    EPwm8Regs.ETPS.bit.INTPRD = 1;              // every time
+    EPwm8Regs.ETSEL.bit.INTEN = 1;
+
+    EPwm8Regs.TBCTL.bit.CTRMODE = 0;            // count up
 }
 
 void ControlPanel :: configureSpiBus( void )
@@ -115,35 +156,21 @@ Uint16 ControlPanel :: reverse_byte(Uint16 x)
     return table[x];
 }
 
-Uint16 ControlPanel :: lcd_char(Uint16 x)
+Uint16 ControlPanel :: toBcd(Uint16 value)
 {
-    static const Uint16 table[] = {
-        0b1111110000000000, // 0
-        0b0110000000000000, // 1
-        0b1101101000000000, // 2
-        0b1111001000000000, // 3
-        0b0110011000000000, // 4
-        0b1011011000000000, // 5
-        0b1011111000000000, // 6
-        0b1110000000000000, // 7
-        0b1111111000000000, // 8
-        0b1111011000000000, // 9
-        0b0000000100000000,  // .
-        0b1111110100000000, // 0.
-        0b0110000100000000, // 1.
-        0b1101101100000000, // 2.
-        0b1111001100000000, // 3.
-        0b0110011100000000, // 4.
-        0b1011011100000000, // 5.
-        0b1011111100000000, // 6.
-        0b1110000100000000, // 7.
-        0b1111111100000000, // 8.
-        0b1111011100000000 // 9.
-    };
-    if( x < sizeof(table) ) {
-        return table[x];
+    // double dabble: shift the binary value up into four BCD digits, adding 3
+    // to any digit of 5 or more before each shift, so no division is needed
+    Uint32 scratch = (value > 9999) ? 9999 : value;
+
+    for( int i=0; i < 14; i++ ) {
+        for( int digit=14; digit < 30; digit += 4 ) {
+            if( ((scratch >> digit) & 0xF) >= 5 ) {
+                scratch += 3UL << digit;
+            }
+        }
+        scratch <<= 1;
     }
-    return table[sizeof(table)-1];
+    return scratch >> 14;
 }
 
 void ControlPanel :: sendData()
@@ -189,27 +216,105 @@ void ControlPanel :: sendData()
 
 void ControlPanel :: decomposeRPM()
 {
-    Uint16 rpm = this->rpm;
+    Uint16 bcd = toBcd(this->rpm);
     int i;
 
     for(i=3; i>=0; i--) {
-        this->sevenSegmentData[i] = (rpm == 0 && i != 3) ? 0 : lcd_char(rpm % 10);
-        rpm = rpm / 10;
+        this->sevenSegmentData[i] = (bcd == 0 && i != 3) ? 0 : DIGIT_GLYPHS[bcd & 0xF];
+        bcd >>= 4;
     }
 }
 
 void ControlPanel :: decomposeSPosition()
 {
-    Uint16 sposition = this->sposition;
+    Uint16 bcd = toBcd(this->sposition);
     int i;
 
     for(i=3; i>=0; i--) {
         if (i == 2 ) {
-              this->sevenSegmentData[i] = lcd_char((sposition % 10) + 11);
+            this->sevenSegmentData[i] = DIGIT_GLYPHS[bcd & 0xF] | POINT;
         } else {
-            this->sevenSegmentData[i] = (sposition == 0 && i != 3) ? 0 : lcd_char(sposition % 10);
+            this->sevenSegmentData[i] = (bcd == 0 && i != 3) ? 0 : DIGIT_GLYPHS[bcd & 0xF];
+        }
+        bcd >>= 4;
+    }
+}
+
+void ControlPanel :: decomposeCarriagePosition()
+{
+    decomposeFixed(this->carriagePosition, this->carriageDecimals, this->sevenSegmentData);
+}
+
+void ControlPanel :: decomposeDivision()
+{
+    int i;
+
+    if( this->division == 0 ) {
+        // not referenced to the index yet
+        for(i=0; i<8; i++) {
+            this->sevenSegmentData[i] = DASH;
+        }
+        return;
+    }
+
+    Uint16 bcd = toBcd(this->division);
+    for(i=3; i>=0; i--) {
+        this->sevenSegmentData[i] = (bcd == 0 && i != 3) ? 0 : DIGIT_GLYPHS[bcd & 0xF];
+        bcd >>= 4;
+    }
+
+    decomposeFixed(this->divisionError, 1, this->sevenSegmentData + 4);
+}
+
+void ControlPanel :: decomposeBacklash()
+{
+    Uint16 bcd = toBcd(this->backlash);
+    int i;
+
+    for(i=3; i>=0; i--) {
+        this->sevenSegmentData[i] = (bcd == 0 && i != 3) ? 0 : DIGIT_GLYPHS[bcd & 0xF];
+        bcd >>= 4;
+    }
+}
+
+void ControlPanel :: decomposeFixed(int32 value, Uint16 decimals, Uint16 *glyphs)
+{
+    bool negative = value < 0;
+    int units = 3 - decimals;
+    int i;
+
+    if( negative ) value = -value;
+
+    if( value > 9999 ) {
+        // doesn't fit in four digits
+        for(i=0; i<4; i++) {
+            glyphs[i] = DASH;
+        }
+        return;
+    }
+
+    Uint16 bcd = toBcd(value);
+
+    for(i=3; i>=0; i--) {
+        if( i == units && decimals > 0 ) {
+            glyphs[i] = DIGIT_GLYPHS[bcd & 0xF] | POINT;
+        }
+        else if( bcd == 0 && i < units ) {
+            // leading blank; the first one carries the minus sign
+            glyphs[i] = negative ? DASH : 0;
+            negative = false;
+        }
+        else {
+            glyphs[i] = DIGIT_GLYPHS[bcd & 0xF];
+        }
+        bcd >>= 4;
+    }
+
+    if( negative ) {
+        // no room left for the minus sign
+        for(i=0; i<4; i++) {
+            glyphs[i] = DASH;
         }
-        sposition = sposition / 10;
     }
 }
 
@@ -259,23 +364,115 @@ KEY_REG ControlPanel :: readKeys(void)
     return keyMask;
 }
 
-KEY_REG ControlPanel :: getKeys()
+void ControlPanel :: scanKeys(void)
 {
-    KEY_REG newKeys;
-    static KEY_REG noKeys;
+    this->scanTime += 1000 / KEY_SCAN_RATE_HZ;
+
+    // held keys repeat on time, whether or not they can be read this time
+    repeatKeys();
+
+    // the main loop is using the bus; catch up on the next scan
+    if( this->spiBus->isLocked() ) {
+        return;
+    }
 
     configureSpiBus();
+    KEY_REG newKeys = readKeys();
 
-    newKeys = readKeys();
-    if( isValidKeyState(newKeys) && isStable(newKeys) && newKeys.all != this->keys.all ) {
-        KEY_REG previousKeys = this->keys; // remember the previous stable value
-        this->keys = newKeys;
+    // a read with several keys down is a communication error; skip it
+    if( isValidKeyState(newKeys) ) {
+        debounce(newKeys);
+    }
+}
+
+void ControlPanel :: debounce(KEY_REG newKeys)
+{
+    Uint16 keys = this->keys.all;
 
-        if( previousKeys.all == 0 ) {     // only act if the previous stable value was no keys pressed
-            return newKeys;
+    for( Uint16 i=0; i < 8; i++ ) {
+        Uint16 bit = 1 << i;
+
+        if( newKeys.all & bit ) {
+            if( this->integrator[i] < KEY_DEBOUNCE_SCANS ) this->integrator[i]++;
+        }
+        else {
+            if( this->integrator[i] > 0 ) this->integrator[i]--;
+        }
+
+        // only change state at either end of the range
+        if( this->integrator[i] == KEY_DEBOUNCE_SCANS && !(keys & bit) ) {
+            keys |= bit;
+            postKeyEvent(bit, KEY_PRESSED, 1);
+
+            if( bit & KEY_REPEAT_MASK ) {
+                this->repeatKey = bit;
+                this->repeatTime = this->scanTime + KEY_REPEAT_DELAY_MS;
+                this->repeatCount = 0;
+            }
         }
+        else if( this->integrator[i] == 0 && (keys & bit) ) {
+            keys &= ~bit;
+            postKeyEvent(bit, KEY_RELEASED, 1);
+
+            if( bit == this->repeatKey ) {
+                this->repeatKey = 0;
+            }
+        }
+    }
+
+    this->keys.all = keys;
+}
+
+void ControlPanel :: repeatKeys(void)
+{
+    if( this->repeatKey == 0 || (int32)(this->scanTime - this->repeatTime) < 0 ) {
+        return;
+    }
+
+    // act on more rows at a time the longer the key is held
+    Uint16 count = 1;
+#if KEY_REPEAT_ACCELERATION > 0
+    count += this->repeatCount / KEY_REPEAT_ACCELERATION;
+    if( count > KEY_REPEAT_MAX_COUNT ) {
+        count = KEY_REPEAT_MAX_COUNT;
+    }
+#endif // KEY_REPEAT_ACCELERATION
+
+    postKeyEvent(this->repeatKey, KEY_REPEATED, count);
+    this->repeatTime += KEY_REPEAT_INTERVAL_MS;
+    if( this->repeatCount < 0xFFFF ) {
+        this->repeatCount++;
+    }
+}
+
+void ControlPanel :: postKeyEvent(Uint16 key, KEY_EVENT_TYPE type, Uint16 count)
+{
+    Uint16 head = this->queueHead;
+    Uint16 next = (head + 1) & (KEY_QUEUE_SIZE - 1);
+
+    // drop the event if the user interface has fallen that far behind
+    if( next == this->queueTail ) {
+        return;
     }
-    return noKeys;
+
+    this->queue[head].key.all = key;
+    this->queue[head].type = type;
+    this->queue[head].count = count;
+    this->queue[head].time = this->scanTime;
+    this->queueHead = next;
+}
+
+bool ControlPanel :: getKeyEvent(KEY_EVENT *event)
+{
+    Uint16 tail = this->queueTail;
+
+    if( tail == this->queueHead ) {
+        return false;
+    }
+
+    *event = this->queue[tail];
+    this->queueTail = (tail + 1) & (KEY_QUEUE_SIZE - 1);
+    return true;
 }
 
 bool ControlPanel :: isValidKeyState(KEY_REG testKeys) {
@@ -296,22 +493,11 @@ bool ControlPanel :: isValidKeyState(KEY_REG testKeys) {
 }
 
 
-bool ControlPanel :: isStable(KEY_REG testKeys) {
-    // don't trust any read key state until we've seen it multiple times consecutively (noise filter)
-    if( testKeys.all != stableKeys.all )
-    {
-        this->stableKeys = testKeys;
-        this->stableCount = 1;
-    }
-    else
-    {
-        if( this->stableCount < MIN_CONSECUTIVE_READS )
-        {
-            this->stableCount++;
-        }
-    }
-
-    return this->stableCount >= MIN_CONSECUTIVE_READS;
+void ControlPanel :: releaseBus( void )
+{
+    CS_RELEASE;
+    this->spiBus->reset();
+    DELAY_US(CS_RISE_TIME_US);
 }
 
 void ControlPanel :: setMessage( const Uint16 *message )
@@ -326,20 +512,66 @@ void ControlPanel :: setBrightness( Uint16 brightness )
     this->brightness = brightness;
 }
 
-void ControlPanel :: refresh(bool showposition)
+void ControlPanel :: refresh(DISPLAY_MODE mode)
 {
+    this->spiBus->lock();
     configureSpiBus();
 
-    if ( showposition )
+    // the left-hand digits are only rebuilt when what they show changes
+    int32 shown;
+    switch( mode )
     {
-        decomposeSPosition();
-    } else {
-        decomposeRPM();
+    case DISPLAY_SPOSITION:
+        shown = this->sposition;
+        break;
+    case DISPLAY_CARRIAGE:
+        shown = this->carriagePosition;
+        break;
+    case DISPLAY_DIVIDING:
+        shown = ((int32)this->division << 16) | (Uint16)this->divisionError;
+        break;
+    case DISPLAY_BACKLASH:
+        shown = this->backlash;
+        break;
+    default:
+        shown = this->rpm;
+        break;
     }
 
-    decomposeValue();
+    if( ! this->rendered || mode != this->renderedMode || shown != this->renderedValue ||
+            this->carriageDecimals != this->renderedDecimals )
+    {
+        switch( mode )
+        {
+        case DISPLAY_SPOSITION:
+            decomposeSPosition();
+            break;
+        case DISPLAY_CARRIAGE:
+            decomposeCarriagePosition();
+            break;
+        case DISPLAY_DIVIDING:
+            decomposeDivision();
+            break;
+        case DISPLAY_BACKLASH:
+            decomposeBacklash();
+            break;
+        default:
+            decomposeRPM();
+            break;
+        }
+        this->rendered = true;
+        this->renderedMode = mode;
+        this->renderedValue = shown;
+        this->renderedDecimals = this->carriageDecimals;
+    }
+
+    // the dividing head fills the right-hand digits too
+    if( mode != DISPLAY_DIVIDING ) {
+        decomposeValue();
+    }
 
     sendData();
+    this->spiBus->unlock();
 }
 
 
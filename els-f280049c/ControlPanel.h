@@ -28,6 +28,7 @@
 #define __CONTROL_PANEL_H
 
 #include "F28x_Project.h"
+#include "Configuration.h"
 #include "SPIBus.h"
 
 
@@ -118,6 +119,41 @@ typedef union KEY_REG
     struct KEY_BITS bit;
 } KEY_REG;
 
+// What happened to a key
+typedef enum KEY_EVENT_TYPE
+{
+    KEY_PRESSED,
+    KEY_REPEATED,       // still held, and due to act again
+    KEY_RELEASED
+} KEY_EVENT_TYPE;
+
+// A key event, when it happened, in milliseconds since startup, and how many
+// times it should act: more than one once a held key speeds up
+typedef struct KEY_EVENT
+{
+    KEY_REG key;
+    KEY_EVENT_TYPE type;
+    Uint16 count;
+    Uint32 time;
+} KEY_EVENT;
+
+// Keys that repeat when held
+#define KEY_REPEAT_MASK ((1<<0) | (1<<2))   // UP, DOWN
+
+// Key events waiting for the user interface; a power of two
+#define KEY_QUEUE_SIZE 16
+
+
+// What to show in the left-hand (RPM) display
+typedef enum DISPLAY_MODE
+{
+    DISPLAY_RPM,
+    DISPLAY_SPOSITION,
+    DISPLAY_CARRIAGE,
+    DISPLAY_DIVIDING,       // division in the left-hand display, error in the right
+    DISPLAY_BACKLASH        // backlash take-up steps in the left-hand display
+} DISPLAY_MODE;
+
 
 class ControlPanel
 {
@@ -131,18 +167,44 @@ private:
     // Current spindle position value
     Uint16 sposition;
 
+    // Current carriage position value, and digits after the decimal point
+    int32 carriagePosition;
+    Uint16 carriageDecimals;
+
+    // Current dividing head division, counting from 1, or 0 if not yet
+    // referenced, and the error to its detent in tenths of a degree
+    Uint16 division;
+    int16 divisionError;
+
+    // Current backlash setting, in steps
+    Uint16 backlash;
+
     // Current displayed setting value, 4 digits
     const Uint16 *value;
 
     // Current LED states
     LED_REG leds;
 
-    // current key states
-    KEY_REG keys;
+    // debounced key states
+    volatile KEY_REG keys;
+
+    // debounce integrator for each key, counting up while it reads pressed
+    // and down while it reads released
+    Uint16 integrator[8];
+
+    // time of the current scan, in milliseconds
+    Uint32 scanTime;
 
-    // number of times current key state has been seen
-    KEY_REG stableKeys;
-    Uint16 stableCount;
+    // the held key that is repeating, when it next repeats, and how many
+    // times it has
+    Uint16 repeatKey;
+    Uint32 repeatTime;
+    Uint16 repeatCount;
+
+    // key events from the scan, waiting for the user interface
+    KEY_EVENT queue[KEY_QUEUE_SIZE];
+    volatile Uint16 queueHead;
+    volatile Uint16 queueTail;
 
     // current override message, or NULL if none
     const Uint16 *message;
@@ -153,6 +215,12 @@ private:
     // Derived state, calculated internally
     Uint16 sevenSegmentData[8];
 
+    // what the left-hand digits were last built from
+    bool rendered;
+    DISPLAY_MODE renderedMode;
+    int32 renderedValue;
+    Uint16 renderedDecimals;
+
     // dummy register, for SPI
     Uint16 dummy;
 
@@ -161,9 +229,13 @@ private:
 
     void decomposeRPM(void);
     void decomposeSPosition(void);
+    void decomposeCarriagePosition(void);
+    void decomposeDivision(void);
+    void decomposeBacklash(void);
+    void decomposeFixed(int32 value, Uint16 decimals, Uint16 *glyphs);
     void decomposeValue(void);
     KEY_REG readKeys(void);
-    Uint16 lcd_char(Uint16 x);
+    Uint16 toBcd(Uint16 value);
     void sendByte(Uint16 data);
     Uint16 receiveByte(void);
     void sendData(void);
@@ -171,16 +243,25 @@ private:
     void initSpi();
     void configureSpiBus(void);
     bool isValidKeyState(KEY_REG);
-    bool isStable(KEY_REG);
+    void debounce(KEY_REG);
+    void postKeyEvent(Uint16 key, KEY_EVENT_TYPE type, Uint16 count);
+    void repeatKeys(void);
+    void initScanTimer(void);
 
 public:
     ControlPanel(SPIBus *spiBus);
 
-    // initialize the hardware for operation
+    // initialize the hardware for operation, including the key scan timer
     void initHardware(void);
 
-    // poll the keys and return a mask
-    KEY_REG getKeys(void);
+    // read and debounce the keys; called from the key scan timer interrupt
+    void scanKeys(void);
+
+    // take the oldest key event; returns false if there are none
+    bool getKeyEvent(KEY_EVENT *event);
+
+    // keys currently held down, after debouncing
+    KEY_REG getHeldKeys(void);
 
     // set the RPM value to display
     void setRPM(Uint16 rpm);
@@ -188,6 +269,16 @@ public:
     // set the Spindle Position value to display
     void setSPosition(Uint16 sposition);
 
+    // set the Carriage Position value to display, with a fixed number of decimals
+    void setCarriagePosition(int32 position, Uint16 decimals);
+
+    // set the dividing head division and its error, in tenths of a degree,
+    // to display; division 0 shows dashes until the index is found
+    void setDivision(Uint16 division, int16 error);
+
+    // set the backlash setting to display, in steps
+    void setBacklash(Uint16 backlash);
+
     // set the value to display
     void setValue(const Uint16 *value);
 
@@ -201,7 +292,11 @@ public:
     void setBrightness(Uint16 brightness);
 
     // refresh the hardware display
-    void refresh(bool showposition);
+    void refresh(DISPLAY_MODE mode);
+
+    // deselect the panel and abandon any transfer, so the bus can be used
+    // from an interrupt
+    void releaseBus(void);
 };
 
 
@@ -215,6 +310,30 @@ inline void ControlPanel :: setSPosition(Uint16 sposition)
     this->sposition = sposition;
 }
 
+inline void ControlPanel :: setCarriagePosition(int32 position, Uint16 decimals)
+{
+    this->carriagePosition = position;
+    this->carriageDecimals = decimals;
+}
+
+inline void ControlPanel :: setDivision(Uint16 division, int16 error)
+{
+    this->division = division;
+    this->divisionError = error;
+}
+
+inline void ControlPanel :: setBacklash(Uint16 backlash)
+{
+    this->backlash = backlash;
+}
+
+inline KEY_REG ControlPanel :: getHeldKeys(void)
+{
+    KEY_REG keys;
+    keys.all = this->keys.all;
+    return keys;
+}
+
 inline void ControlPanel :: setValue(const Uint16 *value)
 {
     this->value = value;
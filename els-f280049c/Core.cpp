@@ -29,7 +29,8 @@
 
 
 
-Core :: Core( Encoder *encoder, StepperDrive *stepperDrive )
+Core :: Core( Encoder *encoder, StepperDrive *stepperDrive ) :
+        jogProfile(JOG_MIN_RATE_HZ, JOG_MAX_RATE_HZ, JOG_ACCELERATION)
 {
     this->encoder = encoder;
     this->stepperDrive = stepperDrive;
@@ -38,10 +39,42 @@ Core :: Core( Encoder *encoder, StepperDrive *stepperDrive )
     this->feedDirection = 0;
 
     this->previousSpindlePosition = 0;
+    this->encoderPosition = 0;
+#if SPINDLE_DEADBAND_COUNTS > 0
+    this->filteredPosition = 0;
+    this->spindleDirection = 1;
+#endif // SPINDLE_DEADBAND_COUNTS
     this->previousFeedDirection = 0;
     this->previousFeed = NULL;
 
     this->powerOn = true; // default to power on
+
+    this->engaged = true; // follow the spindle unless a cycle says otherwise
+    this->armed = false;
+    this->armedDirection = 1;
+
+    this->jogging = false;
+    this->jogPosition = 0;
+    this->jogDirection = 1;
+    this->resync = false;
+
+    this->numSlaves = 0;
+
+    this->pitchCompensation = NULL;
+    this->appliedCorrection = 0;
+    this->compensatedPosition = 0;
+
+#ifdef USE_MPG
+    this->handwheel = NULL;
+#endif // USE_MPG
+
+    this->alarmLatched = false;
+    this->alarmCarriagePosition = 0;
+    this->alarmSpindlePosition = 0;
+
+#ifdef USE_CLA_ENGINE
+    this->claEngine = NULL;
+#endif // USE_CLA_ENGINE
 }
 
 void Core :: setReverse(bool reverse)
@@ -54,15 +87,170 @@ void Core :: setReverse(bool reverse)
     {
         this->feedDirection = 1;
     }
+    for( Uint16 i = 0; i < numSlaves; i++ ) {
+        slaves[i]->setDirection(this->feedDirection);
+    }
+#ifdef USE_CLA_ENGINE
+    publishFeed();
+#endif // USE_CLA_ENGINE
 }
 
 void Core :: setPowerOn(bool powerOn)
 {
     this->powerOn = powerOn;
     this->stepperDrive->setEnabled(powerOn);
+    for( Uint16 i = 0; i < numSlaves; i++ ) {
+        slaves[i]->getDrive()->setEnabled(powerOn);
+    }
+#ifdef USE_CLA_ENGINE
+    if( this->claEngine != NULL ) {
+        this->claEngine->setEnabled(powerOn);
+    }
+#endif // USE_CLA_ENGINE
+}
+
+void Core :: latchAlarm(void)
+{
+    // whatever the leadscrew still owed is part of where it should have been
+    this->alarmCarriagePosition = stepperDrive->getCarriagePosition() +
+            stepperDrive->getDesiredPosition() - stepperDrive->getCurrentPosition();
+    this->alarmSpindlePosition = encoder->getPosition();
+
+    // a jog in progress is abandoned
+    if( this->jogging ) {
+        jogProfile.stop();
+        this->jogging = false;
+        this->resync = true;
+    }
+
+    setPowerOn(false);
+    this->alarmLatched = true;
+}
+
+bool Core :: clearAlarm(void)
+{
+    if( isAlarm() ) {
+        return false;
+    }
+
+    // the carriage should be where it was commanded at the trip, plus the
+    // feed for however far the spindle has turned since, give or take whole
+    // revolutions of the spindle
+    Uint32 maxCount = encoder->getMaxCount();
+    Uint32 turned = (encoder->getPosition() + maxCount - this->alarmSpindlePosition) % maxCount;
+    int32 revolution = feedRatio(maxCount);
+    if( revolution < 0 ) {
+        revolution = -revolution;
+    }
+
+    int32 carriagePosition = stepperDrive->getCarriagePosition();
+    int32 offset = this->alarmCarriagePosition + feedRatio(turned) - carriagePosition;
+
+    // take the nearest position on the same thread phase
+    if( revolution > 0 ) {
+        offset %= revolution;
+        if( offset > revolution / 2 ) {
+            offset -= revolution;
+        }
+        else if( offset < -(revolution / 2) ) {
+            offset += revolution;
+        }
+    }
+
+    this->alarmLatched = false;
+    setPowerOn(true);
+    jogTo(carriagePosition + offset);
+    return true;
+}
+
+#ifdef USE_CLA_ENGINE
+void Core :: setClaEngine(ClaEngine *claEngine)
+{
+    this->claEngine = claEngine;
+    publishFeed();
+    claEngine->setEnabled(this->powerOn);
+}
+
+void Core :: publishFeed(void)
+{
+    if( this->claEngine == NULL || this->feed == NULL ) {
+        return;
+    }
+
+    // the CLA has no 64-bit integers, so it always works in floating point
+#ifdef USE_FLOATING_POINT
+    this->claEngine->setRatio(this->feed * this->feedDirection);
+#else
+    this->claEngine->setRatio((float)this->feed->numerator / this->feed->denominator * this->feedDirection);
+#endif // USE_FLOATING_POINT
+}
+#endif // USE_CLA_ENGINE
+
+void Core :: armAtIndex(int16 carriageDirection)
+{
+    this->engaged = false;
+
+    // the spindle has to count up to move the carriage up, unless reversed
+    this->armedDirection = carriageDirection * this->feedDirection;
+    this->encoder->clearIndexLatch();
+    this->armed = true;
+}
+
+void Core :: engage(void)
+{
+    this->armed = false;
+    this->engaged = true;
+}
+
+void Core :: disengage(void)
+{
+    this->armed = false;
+    this->engaged = false;
+}
+
+bool Core :: addSlaveAxis(SlaveAxis *axis)
+{
+    if( this->numSlaves >= MAX_SLAVE_AXES ) {
+        return false;
+    }
+
+    axis->setDirection(this->feedDirection);
+    axis->getDrive()->setEnabled(this->powerOn);
+    this->slaves[this->numSlaves++] = axis;
+    return true;
 }
 
+void Core :: setPitchCompensation(PitchCompensation *pitchCompensation)
+{
+    // start from the correction at the current position, rather than
+    // stepping it all out at once
+    this->compensatedPosition = stepperDrive->getCarriagePosition();
+    this->appliedCorrection = pitchCompensation->correctionAt(this->compensatedPosition);
+    this->pitchCompensation = pitchCompensation;
+}
 
+#ifdef USE_MPG
+void Core :: setHandwheel(Handwheel *handwheel)
+{
+    this->handwheel = handwheel;
+}
+#endif // USE_MPG
+
+void Core :: jogTo(int32 carriagePosition)
+{
+    int32 distance = carriagePosition - stepperDrive->getCarriagePosition();
+
+    if( this->jogging || distance == 0 ) {
+        return;
+    }
+
+    // jog steps are counted from wherever the drive is now
+    this->jogPosition = stepperDrive->getDesiredPosition();
+    this->jogDirection = (distance > 0) ? 1 : -1;
+    jogProfile.start((distance > 0) ? distance : -distance);
+
+    this->jogging = true;
+}
 
 
 
@@ -31,6 +31,19 @@
 #include "Encoder.h"
 #include "ControlPanel.h"
 #include "Tables.h"
+#include "MotionProfile.h"
+#include "SlaveAxis.h"
+#include "PitchCompensation.h"
+#ifdef USE_MPG
+#include "Handwheel.h"
+#endif // USE_MPG
+#ifdef USE_CLA_ENGINE
+#include "ClaEngine.h"
+#endif // USE_CLA_ENGINE
+
+
+// Maximum number of axes slaved to the spindle besides the leadscrew
+#define MAX_SLAVE_AXES 2
 
 
 class Core
@@ -52,21 +65,137 @@ private:
 
     Uint32 previousSpindlePosition;
 
-    int32 feedRatio(Uint32 count);
+    // encoder count read by the last ISR, before any filtering
+    Uint32 encoderPosition;
+
+#if SPINDLE_DEADBAND_COUNTS > 0
+    // spindle position after the standstill deadband, and the direction it
+    // last moved
+    Uint32 filteredPosition;
+    int16 spindleDirection;
+
+    Uint32 filterSpindle(Uint32 spindlePosition);
+#endif // SPINDLE_DEADBAND_COUNTS
 
     bool powerOn;
 
+    // is the leadscrew following the spindle, or waiting to engage at the
+    // next index pulse with the spindle counting up (+1) or down (-1)?
+    bool engaged;
+    bool armed;
+    int16 armedDirection;
+
+    void engageAtIndex(Uint32 spindlePosition);
+
+    // time-based jog, which drives the leadscrew instead of the spindle
+    MotionProfile jogProfile;
+    bool jogging;
+    int32 jogPosition;
+    int16 jogDirection;
+
+    // resync to the spindle on the next cycle, as for a feed change
+    bool resync;
+
+    void jogISR(void);
+
+    // additional axes stepped alongside the leadscrew
+    SlaveAxis *slaves[MAX_SLAVE_AXES];
+    Uint16 numSlaves;
+
+    // leadscrew pitch error map, if attached, and the correction applied so
+    // far and the carriage position it was computed for
+    PitchCompensation *pitchCompensation;
+    int16 appliedCorrection;
+    int32 compensatedPosition;
+
+    void compensatePitch(void);
+
+#ifdef USE_MPG
+    // handwheel offset added to the spindle position, if attached
+    Handwheel *handwheel;
+#endif // USE_MPG
+
+    // servo alarm, latched by the ISR, with the carriage position the
+    // leadscrew was commanded to and the spindle position when it tripped
+    bool alarmLatched;
+    int32 alarmCarriagePosition;
+    Uint32 alarmSpindlePosition;
+
+    void latchAlarm(void);
+
+#ifdef USE_CLA_ENGINE
+    // engine running on the CLA, if attached
+    ClaEngine *claEngine;
+    void publishFeed(void);
+#endif // USE_CLA_ENGINE
+
 public:
     Core( Encoder *encoder, StepperDrive *stepperDrive );
 
+    // convert a spindle count to leadscrew steps using the current feed
+    int32 feedRatio(Uint32 count);
+
     void setFeed(const FEED_THREAD *feed);
     void setReverse(bool reverse);
     Uint16 getRPM(void);
+    Uint16 getSPosition(void);
     bool isAlarm();
 
+    // has a servo alarm stopped the drives?  clearAlarm() fails while any
+    // drive is still in alarm; otherwise it powers back on and jogs the
+    // carriage onto the thread phase recorded at the trip.  The spindle must
+    // be stopped.
+    bool isAlarmLatched(void);
+    bool clearAlarm(void);
+
+    int32 getCarriagePosition(void);
+    void setCarriagePosition(int32 position);
+    void setStop(int32 position);
+    void clearStop(void);
+    bool isStopSet(void);
+    bool isAtStop(void);
+    int32 getStopPosition(void);
+    void setLimits(int32 minPosition, int32 maxPosition);
+
+    // leadscrew backlash to take up on each reversal, in steps
+    void setBacklash(Uint16 steps);
+
+    // stop following the spindle until the next index pulse that arrives
+    // while the spindle turns so the carriage moves in the given direction
+    void armAtIndex(int16 carriageDirection);
+    void engage(void);
+    void disengage(void);
+    bool isEngaged(void);
+
+    // step another axis from the spindle, alongside the leadscrew
+    bool addSlaveAxis(SlaveAxis *axis);
+
+    // correct the leadscrew for pitch error as the carriage moves
+    void setPitchCompensation(PitchCompensation *pitchCompensation);
+
+#ifdef USE_MPG
+    // move the carriage by hand, on top of the spindle
+    void setHandwheel(Handwheel *handwheel);
+#endif // USE_MPG
+
+    // jog the carriage to a position, independent of the spindle; the
+    // spindle must be stopped
+    void jogTo(int32 carriagePosition);
+    void stopJog(void);
+    bool isJogging(void);
+
     bool isPowerOn();
     void setPowerOn(bool);
 
+#ifdef USE_CLA_ENGINE
+    // hand the feed over to the CLA engine instead of ISR()
+    void setClaEngine(ClaEngine *claEngine);
+#endif // USE_CLA_ENGINE
+
+    // nothing for the ISR to do: the spindle has not moved since the last
+    // cycle and every drive is at rest
+    bool isIdle( void );
+
     void ISR( void );
 };
 
@@ -77,6 +206,12 @@ inline void Core :: setFeed(const FEED_THREAD *feed)
 #else
     this->feed = feed;
 #endif // USE_FLOATING_POINT
+    for( Uint16 i = 0; i < numSlaves; i++ ) {
+        slaves[i]->setFeed(feed);
+    }
+#ifdef USE_CLA_ENGINE
+    publishFeed();
+#endif // USE_CLA_ENGINE
 }
 
 inline Uint16 Core :: getRPM(void)
@@ -84,16 +219,111 @@ inline Uint16 Core :: getRPM(void)
     return encoder->getRPM();
 }
 
+inline Uint16 Core :: getSPosition(void)
+{
+    return encoder->getSPosition();
+}
+
+inline int32 Core :: getCarriagePosition(void)
+{
+#ifdef USE_CLA_ENGINE
+    if( claEngine != NULL ) {
+        return claEngine->getCarriagePosition();
+    }
+#endif // USE_CLA_ENGINE
+    return stepperDrive->getCarriagePosition();
+}
+
+inline void Core :: setCarriagePosition(int32 position)
+{
+    stepperDrive->setCarriagePosition(position);
+}
+
+inline void Core :: setStop(int32 position)
+{
+    stepperDrive->setStop(position);
+}
+
+inline void Core :: clearStop(void)
+{
+    stepperDrive->clearStop();
+}
+
+inline bool Core :: isStopSet(void)
+{
+    return stepperDrive->isStopSet();
+}
+
+inline bool Core :: isAtStop(void)
+{
+    return stepperDrive->isAtStop();
+}
+
+inline int32 Core :: getStopPosition(void)
+{
+    return stepperDrive->getStopPosition();
+}
+
+inline void Core :: setLimits(int32 minPosition, int32 maxPosition)
+{
+    stepperDrive->setLimits(minPosition, maxPosition);
+}
+
+inline void Core :: setBacklash(Uint16 steps)
+{
+    stepperDrive->setBacklash(steps);
+}
+
+inline bool Core :: isEngaged(void)
+{
+    return this->engaged;
+}
+
+inline void Core :: stopJog(void)
+{
+    jogProfile.stop();
+}
+
+inline bool Core :: isJogging(void)
+{
+    return this->jogging;
+}
+
 inline bool Core :: isAlarm()
 {
+    for( Uint16 i = 0; i < numSlaves; i++ ) {
+        if( slaves[i]->getDrive()->isAlarm() ) {
+            return true;
+        }
+    }
     return this->stepperDrive->isAlarm();
 }
 
+#pragma CODE_SECTION("hotfuncs")
+inline bool Core :: isIdle(void)
+{
+    if( this->jogging || encoder->getPosition() != this->encoderPosition ) {
+        return false;
+    }
+    for( Uint16 i = 0; i < numSlaves; i++ ) {
+        if( ! slaves[i]->getDrive()->isIdle() ) {
+            return false;
+        }
+    }
+    return this->stepperDrive->isIdle();
+}
+
+inline bool Core :: isAlarmLatched(void)
+{
+    return this->alarmLatched;
+}
+
 inline bool Core :: isPowerOn()
 {
     return this->powerOn;
 }
 
+#pragma CODE_SECTION("hotfuncs")
 inline int32 Core :: feedRatio(Uint32 count)
 {
 #ifdef USE_FLOATING_POINT
@@ -103,27 +333,157 @@ inline int32 Core :: feedRatio(Uint32 count)
 #endif // USE_FLOATING_POINT
 }
 
+#pragma CODE_SECTION("hotfuncs")
+inline void Core :: engageAtIndex(Uint32 spindlePosition)
+{
+    bool countingUp = encoder->isCountingUp();
+
+    if( countingUp == (armedDirection > 0) ) {
+        Uint32 indexPosition = encoder->getIndexPosition();
+
+        // sync as of the index pulse, so the steps for the counts since then
+        // are still owed and every pass starts on the same thread phase
+        int32 indexSteps = feedRatio(indexPosition);
+        if( indexPosition > spindlePosition && indexPosition - spindlePosition > encoder->getMaxCount()/2 ) {
+            indexSteps -= feedRatio(encoder->getMaxCount());
+        }
+        if( indexPosition < spindlePosition && spindlePosition - indexPosition > encoder->getMaxCount()/2 ) {
+            indexSteps += feedRatio(encoder->getMaxCount());
+        }
+        stepperDrive->setCurrentPosition(indexSteps);
+
+        armed = false;
+        engaged = true;
+    }
+
+    // an index seen turning the wrong way doesn't count
+    encoder->clearIndexLatch();
+}
+
+#if SPINDLE_DEADBAND_COUNTS > 0
+#pragma CODE_SECTION("hotfuncs")
+inline Uint32 Core :: filterSpindle(Uint32 spindlePosition)
+{
+    Uint32 maxCount = encoder->getMaxCount();
+    int32 delta = (int32)spindlePosition - (int32)filteredPosition;
+
+    // take the short way around the encoder wrap
+    if( delta > (int32)(maxCount/2) ) {
+        delta -= maxCount;
+    }
+    else if( delta < -(int32)(maxCount/2) ) {
+        delta += maxCount;
+    }
+
+    // follow motion in the same direction at once, but only follow a reversal
+    // once it is bigger than the deadband; either way the filtered position
+    // lands exactly on the encoder, so nothing is lost
+    if( (delta > 0 && (spindleDirection > 0 || delta > SPINDLE_DEADBAND_COUNTS)) ||
+        (delta < 0 && (spindleDirection < 0 || delta < -SPINDLE_DEADBAND_COUNTS)) ) {
+        filteredPosition = spindlePosition;
+        spindleDirection = (delta > 0) ? 1 : -1;
+    }
+
+    return filteredPosition;
+}
+#endif // SPINDLE_DEADBAND_COUNTS
+
+#pragma CODE_SECTION("hotfuncs")
+inline void Core :: compensatePitch(void)
+{
+    int32 position = stepperDrive->getCarriagePosition();
+
+    // only look up the map when the carriage has moved
+    if( position != compensatedPosition ) {
+        int16 correction = pitchCompensation->correctionAt(position);
+
+        // owe the drive the change in correction since last time
+        stepperDrive->incrementCurrentPosition(appliedCorrection - correction);
+        appliedCorrection = correction;
+        compensatedPosition = position;
+    }
+}
+
+#pragma CODE_SECTION("hotfuncs")
+inline void Core :: jogISR( void )
+{
+    if( jogProfile.tick() ) {
+        jogPosition += jogDirection;
+        stepperDrive->setDesiredPosition(jogPosition);
+    }
+
+    // once the drive has caught up, hand back to the spindle
+    if( jogProfile.isDone() && stepperDrive->isAtDesiredPosition() ) {
+        resync = true;
+        jogging = false;
+    }
+
+    stepperDrive->ISR();
+}
+
+#pragma CODE_SECTION("hotfuncs")
 inline void Core :: ISR( void )
 {
-    if( this->feed != NULL ) {
+#ifdef USE_ALARM_LATCH
+    // stop on the first sign of a servo alarm; latching turns the power off,
+    // so this only trips once
+    if( this->powerOn && isAlarm() ) {
+        latchAlarm();
+    }
+#endif // USE_ALARM_LATCH
+
+    if( this->jogging ) {
+        jogISR();
+    }
+    else if( this->feed != NULL ) {
         // read the encoder
         Uint32 spindlePosition = encoder->getPosition();
+        this->encoderPosition = spindlePosition;
+#if SPINDLE_DEADBAND_COUNTS > 0
+        spindlePosition = filterSpindle(spindlePosition);
+#endif // SPINDLE_DEADBAND_COUNTS
 
         // calculate the desired stepper position
         int32 desiredSteps = feedRatio(spindlePosition);
+#ifdef USE_MPG
+        if( handwheel != NULL ) {
+            desiredSteps += handwheel->tick();
+        }
+#endif // USE_MPG
         stepperDrive->setDesiredPosition(desiredSteps);
 
         // compensate for encoder overflow/underflow
-        if( spindlePosition < previousSpindlePosition && previousSpindlePosition - spindlePosition > encoder->getMaxCount()/2 ) {
-            stepperDrive->incrementCurrentPosition(-1 * feedRatio(encoder->getMaxCount()));
+        Uint32 maxCount = encoder->getMaxCount();
+        int16 wrap = 0;
+        if( spindlePosition < previousSpindlePosition && previousSpindlePosition - spindlePosition > maxCount/2 ) {
+            wrap = -1;
         }
-        if( spindlePosition > previousSpindlePosition && spindlePosition - previousSpindlePosition > encoder->getMaxCount()/2 ) {
-            stepperDrive->incrementCurrentPosition(feedRatio(encoder->getMaxCount()));
+        if( spindlePosition > previousSpindlePosition && spindlePosition - previousSpindlePosition > maxCount/2 ) {
+            wrap = 1;
+        }
+        if( wrap != 0 ) {
+            stepperDrive->incrementCurrentPosition(wrap * feedRatio(maxCount));
         }
 
         // if the feed or direction changed, reset sync to avoid a big step
-        if( feed != previousFeed || feedDirection != previousFeedDirection) {
+        if( feed != previousFeed || feedDirection != previousFeedDirection || resync ) {
             stepperDrive->setCurrentPosition(desiredSteps);
+            resync = false;
+        }
+
+        // apply the leadscrew pitch error correction for this position
+        if( pitchCompensation != NULL ) {
+            compensatePitch();
+        }
+
+        // hold still until the threading cycle lets us engage
+        if( ! engaged ) {
+            if( armed && encoder->isIndexLatched() ) {
+                engageAtIndex(spindlePosition);
+            }
+            else {
+                stepperDrive->setCurrentPosition(desiredSteps);
+            }
         }
 
         // remember values for next time
@@ -133,6 +493,11 @@ inline void Core :: ISR( void )
 
         // service the stepper drive state machine
         stepperDrive->ISR();
+
+        // and the same for every slaved axis
+        for( Uint16 i = 0; i < numSlaves; i++ ) {
+            slaves[i]->ISR(spindlePosition, wrap, maxCount);
+        }
     }
 }
 
@@ -29,7 +29,9 @@
 
 Debug :: Debug( void )
 {
-
+    this->isrStart = 0;
+    this->isrCycles = 0;
+    this->maxIsrCycles = 0;
 }
 
 
@@ -44,4 +46,11 @@ void Debug :: initHardware( void )
     GpioCtrlRegs.GPADIR.bit.GPIO3 = 1;
     GpioDataRegs.GPACLEAR.bit.GPIO3 = 1;
     EDIS;
+
+    // run CPU timer 2 freely at SYSCLK as a cycle counter
+    CpuTimer2Regs.PRD.all = 0xFFFFFFFF;
+    CpuTimer2Regs.TPR.all = 0;
+    CpuTimer2Regs.TPRH.all = 0;
+    CpuTimer2Regs.TCR.bit.TRB = 1;
+    CpuTimer2Regs.TCR.bit.TSS = 0;
 }
@@ -31,6 +31,12 @@
 
 class Debug
 {
+private:
+    // CPU cycles spent in the last and the longest stepper ISR
+    Uint32 isrStart;
+    Uint32 isrCycles;
+    Uint32 maxIsrCycles;
+
 public:
     Debug(void);
     void initHardware(void);
@@ -42,16 +48,29 @@ public:
     // analyzer pin 2
     void begin2( void );
     void end2( void );
+
+    // free-running CPU cycle counter, for instrumentation; the black box
+    // reads the same timer
+    Uint32 cycles( void );
+
+    // stepper ISR timing, measured between begin1() and end1()
+    Uint32 getIsrCycles( void );
+    Uint32 getMaxIsrCycles( void );
 };
 
 
 inline void Debug :: begin1( void )
 {
     GpioDataRegs.GPASET.bit.GPIO2 = 1;
+    this->isrStart = cycles();
 }
 
 inline void Debug :: end1( void )
 {
+    this->isrCycles = cycles() - this->isrStart;
+    if( this->isrCycles > this->maxIsrCycles ) {
+        this->maxIsrCycles = this->isrCycles;
+    }
     GpioDataRegs.GPACLEAR.bit.GPIO2 = 1;
 }
 
@@ -65,5 +84,21 @@ inline void Debug :: end2( void )
     GpioDataRegs.GPACLEAR.bit.GPIO3 = 1;
 }
 
+inline Uint32 Debug :: cycles( void )
+{
+    // CPU timer 2 counts down from 0xFFFFFFFF at SYSCLK
+    return 0xFFFFFFFF - CpuTimer2Regs.TIM.all;
+}
+
+inline Uint32 Debug :: getIsrCycles( void )
+{
+    return this->isrCycles;
+}
+
+inline Uint32 Debug :: getMaxIsrCycles( void )
+{
+    return this->maxIsrCycles;
+}
+
 
 #endif // __DEBUG_H
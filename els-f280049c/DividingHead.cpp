@@ -0,0 +1,125 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "DividingHead.h"
+
+
+DividingHead :: DividingHead(Encoder *encoder)
+{
+    this->encoder = encoder;
+
+    this->indexCount = 0;
+    this->initialIndexPosition = 0;
+    this->referenced = false;
+
+    this->division = 0;
+    this->error = 0;
+
+    setDivisions(DIVIDING_DEFAULT);
+}
+
+void DividingHead :: initHardware(void)
+{
+    // QPOSILAT holds whatever was latched last; wait for it to change
+    this->initialIndexPosition = encoder->getIndexPosition();
+    this->referenced = false;
+}
+
+void DividingHead :: setDivisions(Uint16 divisions)
+{
+    if( divisions < 2 ) divisions = 2;
+    if( divisions > DIVIDING_MAX ) divisions = DIVIDING_MAX;
+
+    this->divisions = divisions;
+
+    // the only division is here, once for each detent
+    for( Uint16 i=0; i <= divisions; i++ ) {
+        this->detents[i] = ((Uint32)i * ENCODER_RESOLUTION + divisions / 2) / divisions;
+    }
+    this->scale = ((Uint32)divisions << 22) / ENCODER_RESOLUTION;
+}
+
+bool DividingHead :: findIndex(void)
+{
+    // the threading cycle clears the latch flag, so also watch for the
+    // latched position changing
+    Uint32 position = encoder->getIndexPosition();
+
+    if( ! encoder->isIndexLatched() && position == this->initialIndexPosition ) {
+        return false;
+    }
+
+    // the counter wraps at a whole number of revolutions, so this only needs
+    // doing once
+    this->indexCount = position % ENCODER_RESOLUTION;
+    this->referenced = true;
+    return true;
+}
+
+void DividingHead :: update(void)
+{
+    Uint16 count = encoder->getRevolutionCount();
+
+    if( ! this->referenced && ! findIndex() ) {
+        return;
+    }
+
+    // counts from the index
+    if( count >= this->indexCount ) {
+        count -= this->indexCount;
+    }
+    else {
+        count += ENCODER_RESOLUTION - this->indexCount;
+    }
+
+    // the fixed-point guess can be one out either way
+    Uint16 d = ((Uint32)count * this->scale) >> 22;
+    if( d >= this->divisions ) {
+        d = this->divisions - 1;
+    }
+    while( d > 0 && this->detents[d] > count ) {
+        d--;
+    }
+    while( this->detents[d + 1] <= count ) {
+        d++;
+    }
+
+    // count is now between detents d and d+1; take the nearer
+    Uint16 past = count - this->detents[d];
+    Uint16 toNext = this->detents[d + 1] - count;
+
+    if( toNext < past ) {
+        d++;
+        if( d == this->divisions ) {
+            d = 0;
+        }
+        this->error = -(int16)(((Uint32)toNext * _SPOSITION_SCALE) >> 20);
+    }
+    else {
+        this->error = ((Uint32)past * _SPOSITION_SCALE) >> 20;
+    }
+    this->division = d;
+}
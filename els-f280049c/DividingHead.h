@@ -0,0 +1,117 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __DIVIDINGHEAD_H
+#define __DIVIDINGHEAD_H
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "Encoder.h"
+
+
+//
+// Dividing head
+//
+// Uses the spindle encoder as an indexer: the revolution is split into a
+// number of equal divisions, starting at the index pulse, and each update
+// finds the detent the spindle is nearest and how far it is from it.  The
+// detent positions are worked out once when the number of divisions is set,
+// so an update is a multiply and a table lookup, with no division.
+//
+class DividingHead
+{
+private:
+    Encoder *encoder;
+
+    // number of divisions in a revolution
+    Uint16 divisions;
+
+    // encoder count of each detent from the index, plus a whole revolution
+    // at the end
+    Uint16 detents[DIVIDING_MAX + 1];
+
+    // divisions per count, in 22-bit fixed point, for the first guess at
+    // the detent
+    Uint32 scale;
+
+    // index position within the revolution, once it has been seen
+    Uint16 indexCount;
+    Uint32 initialIndexPosition;
+    bool referenced;
+
+    // result of the last update
+    Uint16 division;
+    int16 error;
+
+    bool findIndex(void);
+
+public:
+    DividingHead(Encoder *encoder);
+
+    // start looking for the index from the current encoder state
+    void initHardware(void);
+
+    // set the number of divisions, 2 to DIVIDING_MAX
+    void setDivisions(Uint16 divisions);
+    Uint16 getDivisions(void);
+
+    // find the nearest detent; call every pass of the user interface
+    void update(void);
+
+    // whether the index has been seen, so the divisions mean anything
+    bool isReferenced(void);
+
+    // the nearest detent, counting from 0 at the index
+    Uint16 getDivision(void);
+
+    // distance past the nearest detent, in tenths of a degree; negative when
+    // the spindle is short of it
+    int16 getError(void);
+};
+
+
+inline Uint16 DividingHead :: getDivisions(void)
+{
+    return this->divisions;
+}
+
+inline bool DividingHead :: isReferenced(void)
+{
+    return this->referenced;
+}
+
+inline Uint16 DividingHead :: getDivision(void)
+{
+    return this->division;
+}
+
+inline int16 DividingHead :: getError(void)
+{
+    return this->error;
+}
+
+
+#endif // __DIVIDINGHEAD_H
@@ -35,6 +35,9 @@
 // enough time for the CS line to rise and be deteted
 #define CS_RISE_TIME_US 5
 
+// status polls before giving up on a write cycle, about 17ms
+#define EEPROM_WRITE_POLLS 100
+
 EEPROM :: EEPROM(SPIBus *spiBus)
 {
     this->spiBus = spiBus;
@@ -94,9 +97,15 @@ void EEPROM :: setWriteLatch(void)
 
 }
 
-void EEPROM :: waitForWriteCycle(void)
+bool EEPROM :: waitForWriteCycle(void)
 {
-    while( readStatusRegister() & 0b0000000000000001 );
+    // a write cycle takes at most 5ms, and each poll about 170us
+    for( Uint16 i=0; i < EEPROM_WRITE_POLLS; i++ ) {
+        if( (readStatusRegister() & 0b0000000000000001) == 0 ) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void EEPROM :: sendReadCommand(Uint16 blockNumber)
@@ -173,17 +182,29 @@ void EEPROM :: sendPage(Uint16 pageSize, Uint16 *buffer)
 
 bool EEPROM :: readPage(Uint16 pageNum, Uint16 *buffer)
 {
+    this->spiBus->lock();
+
+    // only count timeouts from this transfer
+    this->spiBus->checkTimeout();
+
     CS_ASSERT;
     sendReadCommand(pageNum);
     receivePage(EEPROM_PAGE_SIZE, buffer);
     CS_RELEASE;
     DELAY_US(CS_RISE_TIME_US);
 
-    return true;
+    bool ok = ! this->spiBus->checkTimeout();
+    this->spiBus->unlock();
+    return ok;
 }
 
 bool EEPROM :: writePage(Uint16 pageNum, Uint16 *buffer)
 {
+    this->spiBus->lock();
+
+    // only count timeouts from this transfer
+    this->spiBus->checkTimeout();
+
     setWriteLatch();
 
     CS_ASSERT;
@@ -192,7 +213,36 @@ bool EEPROM :: writePage(Uint16 pageNum, Uint16 *buffer)
     CS_RELEASE;
     DELAY_US(CS_RISE_TIME_US);
 
+    bool complete = waitForWriteCycle();
+
+    bool ok = ! this->spiBus->checkTimeout() && complete;
+    this->spiBus->unlock();
+    return ok;
+}
+
+void EEPROM :: abort(void)
+{
+    // a command cut off part way through is ignored by the chip
+    CS_RELEASE;
+    this->spiBus->reset();
+    DELAY_US(CS_RISE_TIME_US);
+}
+
+bool EEPROM :: writePageNow(Uint16 pageNum, Uint16 *buffer)
+{
+    this->spiBus->lock();
+
+    // a write cycle already under way would ignore this one
     waitForWriteCycle();
 
-    return true;
+    setWriteLatch();
+
+    CS_ASSERT;
+    sendWriteCommand(pageNum);
+    sendPage(EEPROM_PAGE_SIZE, buffer);
+    CS_RELEASE;
+
+    bool ok = ! this->spiBus->checkTimeout();
+    this->spiBus->unlock();
+    return ok;
 }
@@ -33,8 +33,10 @@
 
 #if HARDWARE_VERSION == 1
 #  define EEPROM_CHIP_25AA040A
+#  define EEPROM_PAGES 32
 #elif HARDWARE_VERSION == 2
 #  define EEPROM_CHIP_AT25080B
+#  define EEPROM_PAGES 64
 #else
 #  error Must define a valid HARDWARE_VERSION
 #endif
@@ -43,6 +45,13 @@
 
 #define EEPROM_PAGE_SIZE 8 // 2-byte words
 
+// EEPROM page map
+#define EEPROM_SETTINGS_PAGE 0 // machine settings
+#define EEPROM_PITCH_COMP_PAGE 1 // pitch compensation header, then the table (4 pages)
+#define EEPROM_SNAPSHOT_PAGE 6 // state saved at brownout
+#define EEPROM_FAULT_PAGE 7 // last supervisor fault
+#define EEPROM_BLACKBOX_PAGE 8 // fault black box, to the end of the chip
+
 class EEPROM
 {
 private:
@@ -51,7 +60,7 @@ private:
 
     Uint16 readStatusRegister( void );
     void setWriteLatch( void );
-    void waitForWriteCycle( void );
+    bool waitForWriteCycle( void );
     void sendReadCommand(Uint16 blockNumber);
     void sendWriteCommand(Uint16 blockNumber);
     void receivePage(Uint16 numWords, Uint16 *buffer);
@@ -68,6 +77,14 @@ public:
 
     bool readPage(Uint16 pageNum, Uint16 *buffer);
     bool writePage(Uint16 pageNum, Uint16 *buffer);
+
+    // fast path for a brownout: start the write cycle and return without
+    // waiting for it to finish
+    bool writePageNow(Uint16 pageNum, Uint16 *buffer);
+
+    // deselect the EEPROM and abandon any transfer, so the bus can be used
+    // from an interrupt
+    void abort(void);
 };
 
 
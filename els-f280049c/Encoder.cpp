@@ -28,77 +28,86 @@
 #include "Configuration.h"
 
 
-Encoder :: Encoder( void )
+Encoder :: Encoder( volatile struct EQEP_REGS *regs )
 {
+    this->regs = regs;
     this->previous = 0;
     this->rpm = 0;
     this->sposition = 0;
+    this->spositionCount = 0;
+    this->revolutionCount = 0;
 }
 
 void Encoder :: initHardware(void)
 {
     EALLOW;
 
-#ifdef ENCODER_USE_EQEP1
-    GpioCtrlRegs.GPBPUD.bit.GPIO35 = 0;     // Enable pull-up on GPIO35 (EQEP1A)
-    GpioCtrlRegs.GPBPUD.bit.GPIO37 = 0;     // Enable pull-up on GPIO371 (EQEP1B)
-    GpioCtrlRegs.GPBPUD.bit.GPIO59 = 0;     // Enable pull-up on GPIO59 (EQEP1I)
-
-    GpioCtrlRegs.GPBQSEL1.bit.GPIO35 = 0;   // Sync to SYSCLKOUT GPIO35 (EQEP1A)
-    GpioCtrlRegs.GPBQSEL1.bit.GPIO37 = 0;   // Sync to SYSCLKOUT GPIO37 (EQEP1B)
-    GpioCtrlRegs.GPBQSEL2.bit.GPIO59 = 0;   // Sync to SYSCLKOUT GPIO59 (EQEP1I)
-
-    GpioCtrlRegs.GPBMUX1.bit.GPIO35 = 1;    // Configure GPIO35 as EQEP1A
-    GpioCtrlRegs.GPBGMUX1.bit.GPIO35 = 2;
-    GpioCtrlRegs.GPBMUX1.bit.GPIO37 = 1;    // Configure GPIO37 as EQEP1B
-    GpioCtrlRegs.GPBGMUX1.bit.GPIO37 = 2;
-    GpioCtrlRegs.GPBMUX2.bit.GPIO59 = 3;    // Configure GPIO59 as EQEP1I
-    GpioCtrlRegs.GPBGMUX2.bit.GPIO59 = 2;
-#endif
-#ifdef ENCODER_USE_EQEP2
-    GpioCtrlRegs.GPAPUD.bit.GPIO14 = 0;     // Enable pull-up on GPIO14 (EQEP2A)
-    GpioCtrlRegs.GPAPUD.bit.GPIO15 = 0;     // Enable pull-up on GPIO15 (EQEP2B)
-    GpioCtrlRegs.GPAPUD.bit.GPIO26 = 0;     // Enable pull-up on GPIO26 (EQEP2I)
-
-    GpioCtrlRegs.GPAQSEL1.bit.GPIO14 = 0;   // Sync to SYSCLKOUT GPIO14 (EQEP2A)
-    GpioCtrlRegs.GPAQSEL1.bit.GPIO15 = 0;   // Sync to SYSCLKOUT GPIO15 (EQEP2B)
-    GpioCtrlRegs.GPAQSEL2.bit.GPIO26 = 0;   // Sync to SYSCLKOUT GPIO26 (EQEP2I)
-
-    GpioCtrlRegs.GPAMUX1.bit.GPIO14 = 2;    // Configure GPIO14 as EQEP2A
-    GpioCtrlRegs.GPAGMUX1.bit.GPIO14 = 2;
-    GpioCtrlRegs.GPAMUX1.bit.GPIO15 = 2;    // Configure GPIO15 as EQEP2B
-    GpioCtrlRegs.GPAGMUX1.bit.GPIO15 = 2;
-    GpioCtrlRegs.GPAMUX2.bit.GPIO26 = 2;    // Configure GPIO26 as EQEP2I
-    GpioCtrlRegs.GPAGMUX2.bit.GPIO26 = 0;
-#endif
+    // pins for whichever eQEP this instance reads
+    if( regs == &EQep1Regs ) {
+        GpioCtrlRegs.GPBPUD.bit.GPIO35 = 0;     // Enable pull-up on GPIO35 (EQEP1A)
+        GpioCtrlRegs.GPBPUD.bit.GPIO37 = 0;     // Enable pull-up on GPIO371 (EQEP1B)
+        GpioCtrlRegs.GPBPUD.bit.GPIO59 = 0;     // Enable pull-up on GPIO59 (EQEP1I)
+
+        GpioCtrlRegs.GPBQSEL1.bit.GPIO35 = 0;   // Sync to SYSCLKOUT GPIO35 (EQEP1A)
+        GpioCtrlRegs.GPBQSEL1.bit.GPIO37 = 0;   // Sync to SYSCLKOUT GPIO37 (EQEP1B)
+        GpioCtrlRegs.GPBQSEL2.bit.GPIO59 = 0;   // Sync to SYSCLKOUT GPIO59 (EQEP1I)
+
+        GpioCtrlRegs.GPBMUX1.bit.GPIO35 = 1;    // Configure GPIO35 as EQEP1A
+        GpioCtrlRegs.GPBGMUX1.bit.GPIO35 = 2;
+        GpioCtrlRegs.GPBMUX1.bit.GPIO37 = 1;    // Configure GPIO37 as EQEP1B
+        GpioCtrlRegs.GPBGMUX1.bit.GPIO37 = 2;
+        GpioCtrlRegs.GPBMUX2.bit.GPIO59 = 3;    // Configure GPIO59 as EQEP1I
+        GpioCtrlRegs.GPBGMUX2.bit.GPIO59 = 2;
+    }
+    else {
+        GpioCtrlRegs.GPAPUD.bit.GPIO14 = 0;     // Enable pull-up on GPIO14 (EQEP2A)
+        GpioCtrlRegs.GPAPUD.bit.GPIO15 = 0;     // Enable pull-up on GPIO15 (EQEP2B)
+        GpioCtrlRegs.GPAPUD.bit.GPIO26 = 0;     // Enable pull-up on GPIO26 (EQEP2I)
+
+        GpioCtrlRegs.GPAQSEL1.bit.GPIO14 = 0;   // Sync to SYSCLKOUT GPIO14 (EQEP2A)
+        GpioCtrlRegs.GPAQSEL1.bit.GPIO15 = 0;   // Sync to SYSCLKOUT GPIO15 (EQEP2B)
+        GpioCtrlRegs.GPAQSEL2.bit.GPIO26 = 0;   // Sync to SYSCLKOUT GPIO26 (EQEP2I)
+
+        GpioCtrlRegs.GPAMUX1.bit.GPIO14 = 2;    // Configure GPIO14 as EQEP2A
+        GpioCtrlRegs.GPAGMUX1.bit.GPIO14 = 2;
+        GpioCtrlRegs.GPAMUX1.bit.GPIO15 = 2;    // Configure GPIO15 as EQEP2B
+        GpioCtrlRegs.GPAGMUX1.bit.GPIO15 = 2;
+        GpioCtrlRegs.GPAMUX2.bit.GPIO26 = 2;    // Configure GPIO26 as EQEP2I
+        GpioCtrlRegs.GPAGMUX2.bit.GPIO26 = 0;
+    }
 
     EDIS;
 
-    ENCODER_REGS.QDECCTL.bit.QSRC = 0;         // QEP quadrature count mode
-    ENCODER_REGS.QDECCTL.bit.IGATE = 1;        // gate the index pin
-    ENCODER_REGS.QDECCTL.bit.QAP = 1;          // invert A input
-    ENCODER_REGS.QDECCTL.bit.QBP = 1;          // invert B input
-    ENCODER_REGS.QDECCTL.bit.QIP = 1;          // invert index input
-    ENCODER_REGS.QEPCTL.bit.FREE_SOFT = 2;     // unaffected by emulation suspend
-    ENCODER_REGS.QEPCTL.bit.PCRM = 1;          // position count reset on maximum position
-    ENCODER_REGS.QPOSMAX = _ENCODER_MAX_COUNT;  // Max position count
-    ENCODER_REGS.QEPCTL.bit.SWI = 1;            // Allow writing to QPOSCNT for initialization
-    ENCODER_REGS.QPOSINIT = ENCODER_RESOLUTION; // Initialize QPOSCNT at a high value to avoid problems with under/overflow
+    regs->QDECCTL.bit.QSRC = 0;         // QEP quadrature count mode
+#if defined(ENCODER_HAS_INDEX) && (defined(USE_THREADING_CYCLE) || defined(USE_ENCODER_MONITOR) || defined(USE_DIVIDING_HEAD))
+    regs->QDECCTL.bit.IGATE = 0;        // index pin is wired and something uses it
+#else
+    regs->QDECCTL.bit.IGATE = 1;        // gate the index pin
+#endif
+    regs->QDECCTL.bit.QAP = 1;          // invert A input
+    regs->QDECCTL.bit.QBP = 1;          // invert B input
+    regs->QDECCTL.bit.QIP = 1;          // invert index input
+    regs->QEPCTL.bit.FREE_SOFT = 2;     // unaffected by emulation suspend
+    regs->QEPCTL.bit.PCRM = 1;          // position count reset on maximum position
+    regs->QEPCTL.bit.IEL = 1;           // latch position count on rising edge of index
+    regs->QPOSMAX = _ENCODER_MAX_COUNT - 1; // Max position count; counts 0..QPOSMAX wrap every _ENCODER_MAX_COUNT
+    regs->QEPCTL.bit.SWI = 1;            // Allow writing to QPOSCNT for initialization
+    regs->QPOSINIT = ENCODER_RESOLUTION; // Initialize QPOSCNT at a high value to avoid problems with under/overflow
 
 
-    ENCODER_REGS.QUPRD = CPU_CLOCK_HZ / RPM_CALC_RATE_HZ; // Unit Timer latch at RPM_CALC_RATE_HZ Hz
-    ENCODER_REGS.QEPCTL.bit.UTE=1;             // Unit Timeout Enable
-    ENCODER_REGS.QEPCTL.bit.QCLM=1;            // Latch on unit time out
+    regs->QUPRD = CPU_CLOCK_HZ / RPM_CALC_RATE_HZ; // Unit Timer latch at RPM_CALC_RATE_HZ Hz
+    regs->QEPCTL.bit.UTE=1;             // Unit Timeout Enable
+    regs->QEPCTL.bit.QCLM=1;            // Latch on unit time out
 
-    ENCODER_REGS.QEPCTL.bit.QPEN=1;            // QEP enable
+    regs->QEPCTL.bit.QPEN=1;            // QEP enable
 
 }
 
 Uint16 Encoder :: getRPM(void)
 {
-    if(ENCODER_REGS.QFLG.bit.UTO==1)       // If unit timeout (one 10Hz period)
+    if(regs->QFLG.bit.UTO==1)       // If unit timeout (one 10Hz period)
     {
-        Uint32 current = ENCODER_REGS.QPOSLAT;
+        Uint32 current = regs->QPOSLAT;
         Uint32 count = (current > previous) ? current - previous : previous - current;
 
         // deal with over/underflow
@@ -109,21 +118,47 @@ Uint16 Encoder :: getRPM(void)
         rpm = count * 60 * RPM_CALC_RATE_HZ / ENCODER_RESOLUTION;
 
         previous = current;
-        ENCODER_REGS.QCLR.bit.UTO=1;       // Clear interrupt flag
+        regs->QCLR.bit.UTO=1;       // Clear interrupt flag
     }
 
     return rpm;
 }
 
 Uint16 Encoder :: getSPosition(void)
+{
+    sposition = ((Uint32)getRevolutionCount() * _SPOSITION_SCALE) >> 20;
+
+    return sposition;
+}
+
+Uint16 Encoder :: getRevolutionCount(void)
 {
     // Initialise values
-    if ( ENCODER_REGS.QEPCTL.bit.SWI == 1 ) {
-        ENCODER_REGS.QEPCTL.bit.SWI = 0;
+    if ( regs->QEPCTL.bit.SWI == 1 ) {
+        regs->QEPCTL.bit.SWI = 0;
         sposition = 0;
     }
 
-    sposition = (getPosition() % ENCODER_RESOLUTION * 3600) / ENCODER_RESOLUTION;
+    // follow the place in the revolution from the change since the last read,
+    // taking the short way around the counter wrap, rather than dividing the
+    // whole count down each time
+    Uint32 position = getPosition();
+    int32 delta = (int32)position - (int32)spositionCount;
+    if( delta > (int32)(_ENCODER_MAX_COUNT/2) ) {
+        delta -= _ENCODER_MAX_COUNT;
+    }
+    else if( delta < -(int32)(_ENCODER_MAX_COUNT/2) ) {
+        delta += _ENCODER_MAX_COUNT;
+    }
+    spositionCount = position;
+
+    revolutionCount += delta;
+    while( revolutionCount >= ENCODER_RESOLUTION ) {
+        revolutionCount -= ENCODER_RESOLUTION;
+    }
+    while( revolutionCount < 0 ) {
+        revolutionCount += ENCODER_RESOLUTION;
+    }
 
-    return sposition;
+    return revolutionCount;
 }
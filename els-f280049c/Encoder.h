@@ -30,38 +30,69 @@
 #include "F28x_Project.h"
 #include "Configuration.h"
 
+// the spindle encoder uses one eQEP, and a handwheel can use the other
 #ifdef ENCODER_USE_EQEP1
 #define ENCODER_REGS EQep1Regs
+#define MPG_REGS EQep2Regs
 #endif
 #ifdef ENCODER_USE_EQEP2
 #define ENCODER_REGS EQep2Regs
+#define MPG_REGS EQep1Regs
 #endif
 
-// define _ENCODER_MAX_COUNT as a multiple of ENCODER_RESOLUTION so that the modulo function in getSPosition() overflows correctly
+// define _ENCODER_MAX_COUNT as a multiple of ENCODER_RESOLUTION so that the position within a revolution in getSPosition() overflows correctly
 #define _ENCODER_MAX_COUNT (ENCODER_RESOLUTION * 1024UL)
 
+// tenths of a degree per count, in 20-bit fixed point, rounded up so that the
+// product truncates to the same tenth as an exact division for any common
+// encoder resolution
+#define _SPOSITION_SCALE ((3600UL * 1048576UL + ENCODER_RESOLUTION - 1) / ENCODER_RESOLUTION)
+
 
 class Encoder
 {
 private:
+    volatile struct EQEP_REGS *regs;
+
     Uint32 previous;
     Uint16 rpm;
     Uint32 sposition;
 
+    // the count when the spindle position was last read, and its place in the
+    // revolution
+    Uint32 spositionCount;
+    int32 revolutionCount;
+
 public:
-    Encoder( void );
+    Encoder( volatile struct EQEP_REGS *regs );
     void initHardware( void );
 
     Uint16 getRPM( void );
     Uint16 getSPosition(void);
+    // counts into the current revolution, followed without dividing
+    Uint16 getRevolutionCount(void);
     Uint32 getPosition( void );
     Uint32 getMaxCount( void );
+
+    // index pulse latch, and the direction the count is moving
+    bool isIndexLatched( void );
+    Uint32 getIndexPosition( void );
+    void clearIndexLatch( void );
+    bool isCountingUp( void );
+
+    // signal integrity: quadrature phase errors, direction changes, and the
+    // direction the count was moving at the last index pulse
+    bool isPhaseError( void );
+    void clearPhaseError( void );
+    bool isDirectionChanged( void );
+    void clearDirectionChanged( void );
+    bool wasCountingUpAtIndex( void );
 };
 
 
 inline Uint32 Encoder :: getPosition(void)
 {
-    return ENCODER_REGS.QPOSCNT;
+    return regs->QPOSCNT;
 }
 
 inline Uint32 Encoder :: getMaxCount(void)
@@ -69,6 +100,51 @@ inline Uint32 Encoder :: getMaxCount(void)
     return _ENCODER_MAX_COUNT;
 }
 
+inline bool Encoder :: isIndexLatched(void)
+{
+    return regs->QFLG.bit.IEL;
+}
+
+inline Uint32 Encoder :: getIndexPosition(void)
+{
+    return regs->QPOSILAT;
+}
+
+inline void Encoder :: clearIndexLatch(void)
+{
+    regs->QCLR.bit.IEL = 1;
+}
+
+inline bool Encoder :: isCountingUp(void)
+{
+    return regs->QEPSTS.bit.QDF;
+}
+
+inline bool Encoder :: isPhaseError(void)
+{
+    return regs->QFLG.bit.PHE;
+}
+
+inline void Encoder :: clearPhaseError(void)
+{
+    regs->QCLR.bit.PHE = 1;
+}
+
+inline bool Encoder :: isDirectionChanged(void)
+{
+    return regs->QFLG.bit.QDC;
+}
+
+inline void Encoder :: clearDirectionChanged(void)
+{
+    regs->QCLR.bit.QDC = 1;
+}
+
+inline bool Encoder :: wasCountingUpAtIndex(void)
+{
+    return regs->QEPSTS.bit.QDLF;
+}
+
 
 
 #endif // __ENCODER_H
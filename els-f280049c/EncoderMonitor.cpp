@@ -0,0 +1,104 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "EncoderMonitor.h"
+
+
+EncoderMonitor :: EncoderMonitor(Encoder *encoder)
+{
+    this->encoder = encoder;
+
+    this->indexPosition = 0;
+    this->indexCountingUp = true;
+    this->indexValid = false;
+
+    this->indexErrors = 0;
+    this->phaseErrors = 0;
+    this->directionErrors = 0;
+}
+
+void EncoderMonitor :: initHardware(void)
+{
+    // ignore anything flagged before we started watching
+    this->indexPosition = encoder->getIndexPosition();
+    this->indexValid = false;
+    encoder->clearPhaseError();
+    encoder->clearDirectionChanged();
+}
+
+void EncoderMonitor :: countError(Uint16 *counter)
+{
+    // saturate rather than wrap back to zero
+    if( *counter < 0xFFFF ) {
+        (*counter)++;
+    }
+}
+
+void EncoderMonitor :: checkIndex(void)
+{
+    // QPOSILAT holds the last index position; it is left alone by the
+    // threading cycle, which only clears the latch flag
+    Uint32 position = encoder->getIndexPosition();
+    bool countingUp = encoder->wasCountingUpAtIndex();
+
+    if( position == this->indexPosition ) {
+        return;
+    }
+
+    // the index edge lands a few counts over when the direction changes, so
+    // only compare pulses seen in the same direction
+    if( this->indexValid && countingUp == this->indexCountingUp ) {
+        Uint32 counts = (position >= this->indexPosition) ?
+                position - this->indexPosition :
+                position + encoder->getMaxCount() - this->indexPosition;
+        Uint32 error = counts % ENCODER_RESOLUTION;
+
+        if( error > ENCODER_INDEX_TOLERANCE && ENCODER_RESOLUTION - error > ENCODER_INDEX_TOLERANCE ) {
+            countError(&this->indexErrors);
+        }
+    }
+
+    this->indexPosition = position;
+    this->indexCountingUp = countingUp;
+    this->indexValid = true;
+}
+
+void EncoderMonitor :: loop(void)
+{
+    checkIndex();
+
+    if( encoder->isPhaseError() ) {
+        countError(&this->phaseErrors);
+        encoder->clearPhaseError();
+    }
+
+    if( encoder->isDirectionChanged() ) {
+        if( encoder->getRPM() >= ENCODER_DIRECTION_RPM ) {
+            countError(&this->directionErrors);
+        }
+        encoder->clearDirectionChanged();
+    }
+}
@@ -0,0 +1,100 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __ENCODERMONITOR_H
+#define __ENCODERMONITOR_H
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "Encoder.h"
+
+
+//
+// Background check of the spindle encoder signal
+//
+// Runs from the main loop and only reads latched eQEP registers, so it adds
+// nothing to the stepper ISR.  At every index pulse, the position latched in
+// QPOSILAT must be a whole number of revolutions from the previous one, or
+// counts were gained or lost in between.  The eQEP also flags quadrature phase
+// errors, and a direction change while the spindle is turning at speed can
+// only be noise.
+//
+class EncoderMonitor
+{
+private:
+    Encoder *encoder;
+
+    // last index position seen, and the direction it was latched in
+    Uint32 indexPosition;
+    bool indexCountingUp;
+    bool indexValid;
+
+    Uint16 indexErrors;
+    Uint16 phaseErrors;
+    Uint16 directionErrors;
+
+    void checkIndex(void);
+    void countError(Uint16 *counter);
+
+public:
+    EncoderMonitor(Encoder *encoder);
+
+    // start checking from the current encoder state
+    void initHardware(void);
+
+    // check for new errors; call regularly from the main loop
+    void loop(void);
+
+    Uint16 getIndexErrors(void);
+    Uint16 getPhaseErrors(void);
+    Uint16 getDirectionErrors(void);
+
+    // total of all the counters, for spotting new errors
+    Uint16 getErrorCount(void);
+};
+
+inline Uint16 EncoderMonitor :: getIndexErrors(void)
+{
+    return this->indexErrors;
+}
+
+inline Uint16 EncoderMonitor :: getPhaseErrors(void)
+{
+    return this->phaseErrors;
+}
+
+inline Uint16 EncoderMonitor :: getDirectionErrors(void)
+{
+    return this->directionErrors;
+}
+
+inline Uint16 EncoderMonitor :: getErrorCount(void)
+{
+    return this->indexErrors + this->phaseErrors + this->directionErrors;
+}
+
+
+#endif // __ENCODERMONITOR_H
@@ -0,0 +1,78 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "Handwheel.h"
+
+
+// Selector inputs, active low: neither one selected is x1
+#define MPG_X10_PIN GPIO10
+#define MPG_X100_PIN GPIO11
+
+
+Handwheel :: Handwheel(Encoder *encoder)
+{
+    this->encoder = encoder;
+
+    this->scale = 1;
+
+    this->previousCount = 0;
+    this->counts = 0;
+    this->detents = 0;
+
+    this->targetOffset = 0;
+    this->offset = 0;
+    this->stepDelay = 0;
+}
+
+void Handwheel :: initHardware(void)
+{
+    encoder->initHardware();
+
+    EALLOW;
+    GpioCtrlRegs.GPAMUX1.bit.MPG_X10_PIN = 0;
+    GpioCtrlRegs.GPAMUX1.bit.MPG_X100_PIN = 0;
+    GpioCtrlRegs.GPADIR.bit.MPG_X10_PIN = 0;    // input
+    GpioCtrlRegs.GPADIR.bit.MPG_X100_PIN = 0;   // input
+    GpioCtrlRegs.GPAPUD.bit.MPG_X10_PIN = 0;    // enable pull-up
+    GpioCtrlRegs.GPAPUD.bit.MPG_X100_PIN = 0;   // enable pull-up
+    EDIS;
+
+    // start from wherever the wheel is now
+    this->previousCount = encoder->getPosition();
+}
+
+void Handwheel :: loop(void)
+{
+    if( GpioDataRegs.GPADAT.bit.MPG_X100_PIN == 0 ) {
+        this->scale = 100;
+    }
+    else if( GpioDataRegs.GPADAT.bit.MPG_X10_PIN == 0 ) {
+        this->scale = 10;
+    }
+    else {
+        this->scale = 1;
+    }
+}
@@ -0,0 +1,133 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __HANDWHEEL_H
+#define __HANDWHEEL_H
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "Encoder.h"
+
+
+// Cycles between handwheel steps at MPG_MAX_RATE_HZ
+#define MPG_STEP_CYCLES (1000000 / STEPPER_CYCLE_US / MPG_MAX_RATE_HZ)
+
+// Never run more than this many detents behind the wheel
+#define MPG_MAX_PENDING_DETENTS 10
+
+
+//
+// Manual pulse generator (handwheel) on the spare eQEP
+//
+// The handwheel adds an offset, in leadscrew steps, to wherever the spindle
+// puts the carriage.  With the spindle stopped that jogs the carriage; while
+// threading it shifts the thread phase, for picking up an existing thread.
+// Each detent is worth 1, 10 or 100 steps, from the x10 and x100 selector
+// inputs.  The offset is fed out no faster than MPG_MAX_RATE_HZ.
+//
+class Handwheel
+{
+private:
+    Encoder *encoder;
+
+    // steps per detent
+    Uint16 scale;
+
+    // encoder counts and detents taken in so far
+    Uint32 previousCount;
+    int32 counts;
+    int32 detents;
+
+    // offset the wheel asks for, and the offset fed out so far
+    int32 targetOffset;
+    int32 offset;
+    Uint16 stepDelay;
+
+public:
+    Handwheel(Encoder *encoder);
+
+    // set up the eQEP and the selector inputs
+    void initHardware(void);
+
+    // read the x1/x10/x100 selector; call regularly from the main loop
+    void loop(void);
+
+    Uint16 getScale(void);
+
+    // advance one ISR cycle; returns the offset in leadscrew steps
+    int32 tick(void);
+};
+
+inline Uint16 Handwheel :: getScale(void)
+{
+    return this->scale;
+}
+
+#pragma CODE_SECTION("hotfuncs")
+inline int32 Handwheel :: tick(void)
+{
+    Uint32 count = encoder->getPosition();
+
+    if( count != this->previousCount ) {
+        int32 delta = (int32)count - (int32)this->previousCount;
+        Uint32 maxCount = encoder->getMaxCount();
+        if( delta > (int32)(maxCount/2) ) {
+            delta -= maxCount;
+        }
+        else if( delta < -(int32)(maxCount/2) ) {
+            delta += maxCount;
+        }
+        this->previousCount = count;
+
+        // whole detents only, so the carriage doesn't creep between clicks
+        this->counts += delta;
+        int32 detents = this->counts >> MPG_DETENT_SHIFT;
+        this->targetOffset += (detents - this->detents) * this->scale;
+        this->detents = detents;
+
+        // drop whatever the drive can't catch up with
+        int32 maxPending = (int32)MPG_MAX_PENDING_DETENTS * this->scale;
+        if( this->targetOffset > this->offset + maxPending ) {
+            this->targetOffset = this->offset + maxPending;
+        }
+        else if( this->targetOffset < this->offset - maxPending ) {
+            this->targetOffset = this->offset - maxPending;
+        }
+    }
+
+    if( this->stepDelay > 0 ) {
+        this->stepDelay--;
+    }
+    else if( this->offset != this->targetOffset ) {
+        this->offset += (this->targetOffset > this->offset) ? 1 : -1;
+        this->stepDelay = MPG_STEP_CYCLES;
+    }
+
+    return this->offset;
+}
+
+
+#endif // __HANDWHEEL_H
@@ -0,0 +1,72 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "MotionProfile.h"
+
+
+#define CYCLES_PER_SECOND ((Uint64)1000000 / STEPPER_CYCLE_US)
+
+
+MotionProfile :: MotionProfile(Uint32 minRateHz, Uint32 maxRateHz, Uint32 accelerationHz2)
+{
+    this->minVelocity = ((Uint64)minRateHz << 32) / CYCLES_PER_SECOND;
+    this->maxVelocity = ((Uint64)maxRateHz << 32) / CYCLES_PER_SECOND;
+    this->acceleration = ((Uint64)accelerationHz2 << 32) / (CYCLES_PER_SECOND * CYCLES_PER_SECOND);
+
+    // at constant acceleration a, going from v0 to v1 takes (v1^2-v0^2)/2a steps
+    this->accelerationSteps = ((Uint64)maxRateHz * maxRateHz - (Uint64)minRateHz * minRateHz) /
+            (2 * (Uint64)accelerationHz2);
+
+    this->velocity = 0;
+    this->phase = 0;
+    this->remaining = 0;
+    this->rampSteps = 0;
+    this->brakeSteps = 0;
+}
+
+void MotionProfile :: start(Uint32 steps)
+{
+    this->remaining = 0;
+
+    // the first step goes out on the first cycle, at the minimum rate
+    this->velocity = this->minVelocity;
+    this->phase = 0 - this->minVelocity;
+    this->rampSteps = 0;
+
+    // a short move never reaches the maximum rate, and turns round halfway
+    this->brakeSteps = (steps / 2 < this->accelerationSteps) ? steps / 2 : this->accelerationSteps;
+
+    this->remaining = steps;
+}
+
+void MotionProfile :: stop(void)
+{
+    // ramping down takes as many steps as ramping up did; start now
+    if( this->remaining > this->rampSteps ) {
+        this->remaining = this->rampSteps;
+    }
+    this->brakeSteps = this->remaining;
+}
@@ -0,0 +1,119 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __MOTIONPROFILE_H
+#define __MOTIONPROFILE_H
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+
+
+//
+// Time-based trapezoidal velocity profile
+//
+// Generates steps for a move of a known length, one ISR cycle at a time,
+// starting and finishing at a minimum rate that the motor can start and stop
+// at, accelerating to a maximum rate in between.  Velocities are held in
+// 32-bit binary fractions of a step per ISR cycle and steps come from a phase
+// accumulator, so no increment is lost at any rate.  The point where the
+// deceleration starts is worked out when the move starts, so the ISR does no
+// division.
+//
+class MotionProfile
+{
+private:
+    // limits, in 1/2^32 steps per ISR cycle and per ISR cycle squared
+    Uint32 minVelocity;
+    Uint32 maxVelocity;
+    Uint32 acceleration;
+
+    // steps it takes to get from the minimum to the maximum rate
+    Uint32 accelerationSteps;
+
+    // current velocity, and step phase; a step is due each time it wraps
+    Uint32 velocity;
+    Uint32 phase;
+
+    // steps left in the move, steps taken while accelerating, and steps left
+    // when the deceleration starts
+    Uint32 remaining;
+    Uint32 rampSteps;
+    Uint32 brakeSteps;
+
+public:
+    MotionProfile(Uint32 minRateHz, Uint32 maxRateHz, Uint32 accelerationHz2);
+
+    // begin a move of the given number of steps
+    void start(Uint32 steps);
+
+    // shorten the move so it decelerates to a stop as soon as possible
+    void stop(void);
+
+    bool isDone(void);
+
+    // advance one ISR cycle; returns true if a step is due
+    bool tick(void);
+};
+
+inline bool MotionProfile :: isDone(void)
+{
+    return this->remaining == 0;
+}
+
+#pragma CODE_SECTION("hotfuncs")
+inline bool MotionProfile :: tick(void)
+{
+    if( this->remaining == 0 ) {
+        return false;
+    }
+
+    bool accelerating = false;
+
+    if( this->remaining <= this->brakeSteps ) {
+        // decelerate, but no slower than the minimum rate
+        this->velocity = (this->velocity > this->minVelocity + this->acceleration) ?
+                this->velocity - this->acceleration : this->minVelocity;
+    }
+    else if( this->velocity < this->maxVelocity ) {
+        this->velocity = (this->velocity < this->maxVelocity - this->acceleration) ?
+                this->velocity + this->acceleration : this->maxVelocity;
+        accelerating = true;
+    }
+
+    Uint32 previous = this->phase;
+    this->phase += this->velocity;
+    if( this->phase < previous ) {
+        this->remaining--;
+        if( accelerating ) {
+            this->rampSteps++;
+        }
+        return true;
+    }
+    return false;
+}
+
+
+#endif // __MOTIONPROFILE_H
@@ -0,0 +1,134 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "PitchCompensation.h"
+
+
+static const int16 DEFAULT_TABLE[] = PITCH_COMP_TABLE;
+#define DEFAULT_POINTS (sizeof(DEFAULT_TABLE) / sizeof(DEFAULT_TABLE[0]))
+
+
+PitchCompensation :: PitchCompensation(EEPROM *eeprom)
+{
+    this->eeprom = eeprom;
+    setDefaults();
+}
+
+void PitchCompensation :: setDefaults(void)
+{
+    for( Uint16 i=0; i < EEPROM_PAGE_SIZE; i++ ) {
+        this->header.all[i] = 0;
+    }
+    this->header.bit.signature = PITCH_COMP_SIGNATURE;
+    this->header.bit.version = PITCH_COMP_VERSION;
+    this->header.bit.numPoints = DEFAULT_POINTS;
+    this->header.bit.shift = PITCH_COMP_SHIFT;
+    this->header.bit.originLow = ((Uint32)PITCH_COMP_ORIGIN) & 0xFFFF;
+    this->header.bit.originHigh = ((Uint32)PITCH_COMP_ORIGIN) >> 16;
+    this->header.bit.compiledSum = compiledSum();
+
+    for( Uint16 i=0; i < PITCH_COMP_MAX_POINTS; i++ ) {
+        this->points[i] = (i < DEFAULT_POINTS) ? DEFAULT_TABLE[i] : 0;
+    }
+
+    unpack();
+}
+
+void PitchCompensation :: unpack(void)
+{
+    this->origin = (int32)(((Uint32)this->header.bit.originHigh << 16) | this->header.bit.originLow);
+    this->shift = this->header.bit.shift;
+    this->mask = (1L << this->shift) - 1;
+    this->lastIndex = this->header.bit.numPoints - 1;
+}
+
+Uint16 PitchCompensation :: calculateChecksum(void)
+{
+    Uint16 sum = 0;
+
+    // the header, except the checksum word itself, and the whole table
+    for( Uint16 i=0; i < EEPROM_PAGE_SIZE - 1; i++ ) {
+        sum += this->header.all[i];
+    }
+    for( Uint16 i=0; i < PITCH_COMP_MAX_POINTS; i++ ) {
+        sum += (Uint16)this->points[i];
+    }
+    return ~sum;
+}
+
+Uint16 PitchCompensation :: compiledSum(void)
+{
+    Uint16 sum = DEFAULT_POINTS;
+
+    // rotate as we go, so a point moved along the table still shows
+    sum = ((sum << 1) | (sum >> 15)) + PITCH_COMP_SHIFT;
+    sum = ((sum << 1) | (sum >> 15)) + (Uint16)(((Uint32)PITCH_COMP_ORIGIN) & 0xFFFF);
+    sum = ((sum << 1) | (sum >> 15)) + (Uint16)(((Uint32)PITCH_COMP_ORIGIN) >> 16);
+    for( Uint16 i=0; i < DEFAULT_POINTS; i++ ) {
+        sum = ((sum << 1) | (sum >> 15)) + (Uint16)DEFAULT_TABLE[i];
+    }
+    return sum;
+}
+
+void PitchCompensation :: load(void)
+{
+    this->eeprom->readPage(EEPROM_PITCH_COMP_PAGE, this->header.all);
+    for( Uint16 page=0; page < PITCH_COMP_TABLE_PAGES; page++ ) {
+        this->eeprom->readPage(EEPROM_PITCH_COMP_PAGE + 1 + page,
+                (Uint16 *)&this->points[page * EEPROM_PAGE_SIZE]);
+    }
+
+    if( this->header.bit.signature != PITCH_COMP_SIGNATURE ||
+        this->header.bit.version != PITCH_COMP_VERSION ||
+        this->header.bit.checksum != calculateChecksum() ||
+        this->header.bit.numPoints < 1 ||
+        this->header.bit.numPoints > PITCH_COMP_MAX_POINTS ||
+        this->header.bit.shift > 15 )
+    {
+        // blank, corrupt or from an older firmware
+        setDefaults();
+        save();
+    }
+    else if( this->header.bit.compiledSum != compiledSum() )
+    {
+        // PITCH_COMP_TABLE was remeasured for this machine and reflashed
+        setDefaults();
+        save();
+    }
+    else {
+        unpack();
+    }
+}
+
+void PitchCompensation :: save(void)
+{
+    this->header.bit.checksum = calculateChecksum();
+    this->eeprom->writePage(EEPROM_PITCH_COMP_PAGE, this->header.all);
+    for( Uint16 page=0; page < PITCH_COMP_TABLE_PAGES; page++ ) {
+        this->eeprom->writePage(EEPROM_PITCH_COMP_PAGE + 1 + page,
+                (Uint16 *)&this->points[page * EEPROM_PAGE_SIZE]);
+    }
+}
@@ -0,0 +1,122 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __PITCHCOMPENSATION_H
+#define __PITCHCOMPENSATION_H
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "EEPROM.h"
+
+
+// Identifies a table written by this firmware; bump the version whenever the
+// layout of the pages changes so stale tables are replaced with defaults
+#define PITCH_COMP_SIGNATURE 0xE15C
+#define PITCH_COMP_VERSION 2
+
+// Table size, in points; the table takes this many words of EEPROM after the
+// header page
+#define PITCH_COMP_MAX_POINTS 32
+#define PITCH_COMP_TABLE_PAGES (PITCH_COMP_MAX_POINTS / EEPROM_PAGE_SIZE)
+
+struct PITCH_COMP_HEADER_BITS
+{
+    Uint16 signature;
+    Uint16 version;
+    Uint16 numPoints;
+    Uint16 shift;
+    Uint16 originLow;
+    Uint16 originHigh;
+    Uint16 compiledSum;     // fingerprint of the compiled table it came from
+    Uint16 checksum;
+};
+
+typedef union PITCH_COMP_HEADER
+{
+    Uint16 all[EEPROM_PAGE_SIZE];
+    struct PITCH_COMP_HEADER_BITS bit;
+} PITCH_COMP_HEADER;
+
+
+//
+// Leadscrew pitch error compensation map
+//
+// Corrections, in steps, at carriage positions origin, origin + 2^shift,
+// origin + 2*2^shift, and so on.  Between points the correction is
+// interpolated, and beyond the ends it holds the end value.  The spacing is
+// a power of two so the lookup needs only shifts and one multiply.
+//
+class PitchCompensation
+{
+private:
+    EEPROM *eeprom;
+
+    PITCH_COMP_HEADER header;
+    int16 points[PITCH_COMP_MAX_POINTS];
+
+    // unpacked from the header for the lookup
+    int32 origin;
+    Uint16 shift;
+    int32 mask;
+    Uint16 lastIndex;
+
+    Uint16 calculateChecksum(void);
+    Uint16 compiledSum(void);
+    void setDefaults(void);
+    void unpack(void);
+    void save(void);
+
+public:
+    PitchCompensation(EEPROM *eeprom);
+
+    // read the table from EEPROM, falling back to the compiled table if it is
+    // invalid or PITCH_COMP_TABLE has changed since it was stored
+    void load(void);
+
+    // correction, in steps, at a carriage position
+    int16 correctionAt(int32 carriagePosition);
+};
+
+#pragma CODE_SECTION("hotfuncs")
+inline int16 PitchCompensation :: correctionAt(int32 carriagePosition)
+{
+    int32 offset = carriagePosition - this->origin;
+
+    if( offset <= 0 ) {
+        return this->points[0];
+    }
+
+    Uint32 index = ((Uint32)offset) >> this->shift;
+    if( index >= this->lastIndex ) {
+        return this->points[this->lastIndex];
+    }
+
+    int32 span = this->points[index+1] - this->points[index];
+    return this->points[index] + (int16)((span * (offset & this->mask)) >> this->shift);
+}
+
+
+#endif // __PITCHCOMPENSATION_H
@@ -0,0 +1,158 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "PowerMonitor.h"
+
+
+// Supply reading needed before the trip is armed, so a slow power-up doesn't
+// trip it straight away
+#define BROWNOUT_ARM_LEVEL (BROWNOUT_THRESHOLD + BROWNOUT_THRESHOLD / 16)
+
+
+PowerMonitor :: PowerMonitor(EEPROM *eeprom, ControlPanel *controlPanel, Core *core)
+{
+    this->eeprom = eeprom;
+    this->controlPanel = controlPanel;
+    this->core = core;
+
+    for( Uint16 i=0; i < EEPROM_PAGE_SIZE; i++ ) {
+        this->page.all[i] = 0;
+    }
+
+    this->armed = false;
+}
+
+void PowerMonitor :: initHardware(void)
+{
+    SetVREF(ADC_ADCA, ADC_INTERNAL, ADC_VREF3P3);
+    SetVREF(ADC_ADCB, ADC_INTERNAL, ADC_VREF3P3);
+    SetVREF(ADC_ADCC, ADC_INTERNAL, ADC_VREF3P3);
+
+    EALLOW;
+    AdcbRegs.ADCCTL2.bit.PRESCALE = 2;      // ADCCLK = SYSCLK / 2
+    AdcbRegs.ADCCTL1.bit.INTPULSEPOS = 1;   // flags at end of conversion
+    AdcbRegs.ADCCTL1.bit.ADCPWDNZ = 1;      // power up
+    EDIS;
+
+    DELAY_US(1000);                         // ADC power-up time
+
+    EALLOW;
+    AdcbRegs.ADCSOC0CTL.bit.CHSEL = 1;      // ADCINB1, the supply
+    AdcbRegs.ADCSOC0CTL.bit.ACQPS = 30;     // 31 SYSCLK cycles
+    AdcbRegs.ADCSOC0CTL.bit.TRIGSEL = 1;    // CPU1 timer 0, every stepper cycle
+
+    AdcbRegs.ADCPPB1CONFIG.bit.CONFIG = 0;  // compare SOC0
+    AdcbRegs.ADCPPB1TRIPHI.all = 0xFFF;
+    AdcbRegs.ADCPPB1TRIPLO.all = BROWNOUT_THRESHOLD;
+    AdcbRegs.ADCEVTCLR.bit.PPB1TRIPLO = 1;
+    AdcbRegs.ADCEVTINTSEL.bit.PPB1TRIPLO = 0; // armed later, by loop()
+    EDIS;
+}
+
+void PowerMonitor :: loop(void)
+{
+    if( ! this->armed && AdcbResultRegs.ADCRESULT0 >= BROWNOUT_ARM_LEVEL ) {
+        EALLOW;
+        AdcbRegs.ADCEVTCLR.bit.PPB1TRIPLO = 1;
+        AdcbRegs.ADCEVTINTSEL.bit.PPB1TRIPLO = 1;
+        EDIS;
+        this->armed = true;
+    }
+}
+
+Uint16 PowerMonitor :: calculateChecksum(void)
+{
+    Uint16 sum = 0;
+
+    // everything but the checksum word itself
+    for( Uint16 i=0; i < EEPROM_PAGE_SIZE - 1; i++ ) {
+        sum += this->page.all[i];
+    }
+    return ~sum;
+}
+
+bool PowerMonitor :: restore(void)
+{
+    SNAPSHOT_PAGE blank;
+
+    this->eeprom->readPage(EEPROM_SNAPSHOT_PAGE, this->page.all);
+
+    if( this->page.bit.signature != SNAPSHOT_SIGNATURE ||
+        this->page.bit.checksum != calculateChecksum() ) {
+        return false;
+    }
+
+    // a snapshot is only good for one boot
+    for( Uint16 i=0; i < EEPROM_PAGE_SIZE; i++ ) {
+        blank.all[i] = 0;
+    }
+    this->eeprom->writePage(EEPROM_SNAPSHOT_PAGE, blank.all);
+
+    // brownout() restarts with the watchdog if the supply recovers; that
+    // reset was ours, not a stall
+    EALLOW;
+    CpuSysRegs.RESCCLR.bit.WDRSn = 1;
+    EDIS;
+
+    return true;
+}
+
+void PowerMonitor :: brownout(void)
+{
+    // stop stepping first: no more stepper interrupts, and the drives off
+    PieCtrlRegs.PIEIER1.bit.INTx7 = 0;
+    core->setPowerOn(false);
+
+    // fill in the positions and ship the page that is already laid out
+    int32 carriage = core->getCarriagePosition();
+    int32 stop = core->getStopPosition();
+    this->page.bit.signature = SNAPSHOT_SIGNATURE;
+    if( core->isStopSet() ) {
+        this->page.bit.flags |= SNAPSHOT_STOP_SET;
+    }
+    this->page.bit.carriageLow = (Uint32)carriage & 0xFFFF;
+    this->page.bit.carriageHigh = (Uint32)carriage >> 16;
+    this->page.bit.stopLow = (Uint32)stop & 0xFFFF;
+    this->page.bit.stopHigh = (Uint32)stop >> 16;
+    this->page.bit.checksum = calculateChecksum();
+
+    // the interrupted code may have been in the middle of a panel or EEPROM
+    // transfer
+    controlPanel->releaseBus();
+    this->eeprom->abort();
+    this->eeprom->writePageNow(EEPROM_SNAPSHOT_PAGE, this->page.all);
+
+    // nothing else feeds the watchdog now; keep it from resetting the CPU
+    // while the supply is still low, and if the supply comes back after all,
+    // start over with a watchdog reset
+    while( AdcbResultRegs.ADCRESULT0 < BROWNOUT_ARM_LEVEL ) {
+        ServiceDog();
+    }
+    EALLOW;
+    WdRegs.WDCR.all = 0x0028;               // enable the watchdog, and don't feed it
+    EDIS;
+    for(;;);
+}
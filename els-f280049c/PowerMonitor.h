@@ -0,0 +1,145 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __POWERMONITOR_H
+#define __POWERMONITOR_H
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "EEPROM.h"
+#include "ControlPanel.h"
+#include "Core.h"
+
+
+// Identifies a snapshot written by this firmware; change it whenever the
+// layout of SNAPSHOT_BITS changes so stale snapshots are ignored
+#define SNAPSHOT_SIGNATURE 0xE15D
+
+// SNAPSHOT_BITS.flags
+#define SNAPSHOT_METRIC 1
+#define SNAPSHOT_THREAD (1<<1)
+#define SNAPSHOT_REVERSE (1<<2)
+#define SNAPSHOT_POWER_ON (1<<3)
+#define SNAPSHOT_STOP_SET (1<<4)
+
+struct SNAPSHOT_BITS
+{
+    Uint16 signature;
+    Uint16 flags;
+    Uint16 feedIndex;
+    Uint16 carriageLow;
+    Uint16 carriageHigh;
+    Uint16 stopLow;
+    Uint16 stopHigh;
+    Uint16 checksum;
+};
+
+typedef union SNAPSHOT_PAGE
+{
+    Uint16 all[EEPROM_PAGE_SIZE];
+    struct SNAPSHOT_BITS bit;
+} SNAPSHOT_PAGE;
+
+
+//
+// Supply brownout detection and state snapshot
+//
+// ADCB samples the supply on every stepper cycle, and a post-processing
+// block compares each sample against BROWNOUT_THRESHOLD in hardware, so
+// nothing runs until the supply actually droops.  Then the interrupt turns
+// the drives off and writes the machine state to EEPROM in the hold-up time,
+// from a page that is kept ready in RAM.  On the next boot, restore() reads
+// it back.
+//
+class PowerMonitor
+{
+private:
+    EEPROM *eeprom;
+    ControlPanel *controlPanel;
+    Core *core;
+
+    // snapshot image, kept up to date by the user interface
+    SNAPSHOT_PAGE page;
+
+    bool armed;
+
+    Uint16 calculateChecksum(void);
+
+public:
+    PowerMonitor(EEPROM *eeprom, ControlPanel *controlPanel, Core *core);
+
+    // set up the ADC and the trip, but don't arm it yet
+    void initHardware(void);
+
+    // arm the trip once the supply is up; call regularly from the main loop
+    void loop(void);
+
+    // read the snapshot left by the last brownout, and clear it so it is
+    // only used once; returns false if there isn't a valid one.  Call before
+    // Supervisor::checkFault(), so the restart after a brownout is not
+    // reported as a watchdog reset
+    bool restore(void);
+
+    Uint16 getFlags(void);
+    Uint16 getFeedIndex(void);
+    int32 getCarriagePosition(void);
+    int32 getStopPosition(void);
+
+    // record the user interface state for the next snapshot
+    void setState(Uint16 flags, Uint16 feedIndex);
+
+    // from the ADC event interrupt; does not return
+    void brownout(void);
+};
+
+inline Uint16 PowerMonitor :: getFlags(void)
+{
+    return this->page.bit.flags;
+}
+
+inline Uint16 PowerMonitor :: getFeedIndex(void)
+{
+    return this->page.bit.feedIndex;
+}
+
+inline int32 PowerMonitor :: getCarriagePosition(void)
+{
+    return (int32)(((Uint32)this->page.bit.carriageHigh << 16) | this->page.bit.carriageLow);
+}
+
+inline int32 PowerMonitor :: getStopPosition(void)
+{
+    return (int32)(((Uint32)this->page.bit.stopHigh << 16) | this->page.bit.stopLow);
+}
+
+inline void PowerMonitor :: setState(Uint16 flags, Uint16 feedIndex)
+{
+    this->page.bit.flags = flags;
+    this->page.bit.feedIndex = feedIndex;
+}
+
+
+#endif // __POWERMONITOR_H
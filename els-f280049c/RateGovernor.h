@@ -0,0 +1,95 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __RATEGOVERNOR_H
+#define __RATEGOVERNOR_H
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+
+
+// CPU timer 0 periods, in SYSCLK cycles, as ConfigCpuTimer() sets them
+#define FULL_RATE_PERIOD ((Uint32)CPU_CLOCK_MHZ * STEPPER_CYCLE_US)
+#define IDLE_RATE_PERIOD ((Uint32)CPU_CLOCK_MHZ * STEPPER_IDLE_CYCLE_US)
+
+// Full-rate ISR cycles the engine must be idle for before slowing down
+#define IDLE_DELAY_CYCLES (STEPPER_IDLE_DELAY_MS * 1000UL / STEPPER_CYCLE_US)
+
+
+//
+// Stepper interrupt rate governor
+//
+// Runs the stepper interrupt at the full rate only while there is something
+// for it to do.  Once the spindle and every drive have been at rest for
+// STEPPER_IDLE_DELAY_MS, CPU timer 0 is slowed to STEPPER_IDLE_CYCLE_US; the
+// new period is loaded when the counter next reloads, so the cycle in progress
+// is never cut short.  The first encoder count or step owed puts it straight
+// back to full rate, reloading the counter so the next interrupt is one
+// STEPPER_CYCLE_US away.  Everything that times itself in ISR cycles only runs
+// while the engine is busy, and so always sees the full rate.
+//
+class RateGovernor
+{
+private:
+    bool slow;
+    Uint32 idleCycles;
+
+public:
+    RateGovernor(void);
+
+    // call at the end of every stepper interrupt, with Core::isIdle()
+    void ISR(bool idle);
+
+    // is the stepper interrupt running at the idle rate?
+    bool isSlow(void);
+};
+
+
+inline bool RateGovernor :: isSlow(void)
+{
+    return this->slow;
+}
+
+#pragma CODE_SECTION("hotfuncs")
+inline void RateGovernor :: ISR(bool idle)
+{
+    if( ! idle ) {
+        this->idleCycles = 0;
+        if( this->slow ) {
+            // reload now, with the timer interrupt still enabled and running
+            CpuTimer0Regs.PRD.all = FULL_RATE_PERIOD;
+            CpuTimer0Regs.TCR.all = 0x4021;
+            this->slow = false;
+        }
+    }
+    else if( ! this->slow && ++this->idleCycles >= IDLE_DELAY_CYCLES ) {
+        CpuTimer0Regs.PRD.all = IDLE_RATE_PERIOD;
+        this->slow = true;
+    }
+}
+
+
+#endif // __RATEGOVERNOR_H
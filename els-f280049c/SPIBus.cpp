@@ -9,12 +9,17 @@
 #include "F28x_Project.h"
 
 // wait for the current serial shift operation to complete
-#define WAIT_FOR_SERIAL while(SpibRegs.SPISTS.bit.INT_FLAG !=1) {}
+#define WAIT_FOR_SERIAL waitForSerial()
+
+// a 16-bit word takes about 160us to shift; give up after a few times that
+#define SPI_TIMEOUT_LOOPS 20000
 
 
 SPIBus :: SPIBus( void )
 {
     mask = 0xffff;
+    timedOut = false;
+    lockCount = 0;
 }
 
 void SPIBus :: initHardware(void)
@@ -77,6 +82,29 @@ void SPIBus :: sendWord(Uint16 data)
     dummy = SpibRegs.SPIRXBUF;
 }
 
+void SPIBus :: waitForSerial(void)
+{
+    for( Uint16 i=0; i < SPI_TIMEOUT_LOOPS; i++ ) {
+        if( SpibRegs.SPISTS.bit.INT_FLAG == 1 ) {
+            return;
+        }
+    }
+    timedOut = true;
+}
+
+bool SPIBus :: checkTimeout(void)
+{
+    bool result = timedOut;
+    timedOut = false;
+    return result;
+}
+
+void SPIBus :: reset(void)
+{
+    SpibRegs.SPICCR.bit.SPISWRESET = 0; // clears the flags, keeps the configuration
+    SpibRegs.SPICCR.bit.SPISWRESET = 1;
+}
+
 Uint16 SPIBus :: receiveWord(void) {
     SpibRegs.SPICTL.bit.TALK = 0;
     SpibRegs.SPITXBUF = dummy;
@@ -38,6 +38,14 @@ private:
     // mask used to discard high bits on receive
     Uint16 mask;
 
+    // set when a transfer never completed
+    bool timedOut;
+
+    // nesting count of main loop users holding the bus
+    volatile Uint16 lockCount;
+
+    void waitForSerial(void);
+
 public:
     SPIBus(void);
 
@@ -55,7 +63,34 @@ public:
     // receive one word of data
     Uint16 receiveWord(void);
 
+    // abandon any transfer in progress
+    void reset(void);
+
+    // did any transfer time out since the last check?
+    bool checkTimeout(void);
+
+    // hold the bus for a transaction from the main loop, so the key scan
+    // interrupt leaves it alone
+    void lock(void);
+    void unlock(void);
+    bool isLocked(void);
+
 };
 
+inline void SPIBus :: lock(void)
+{
+    this->lockCount++;
+}
+
+inline void SPIBus :: unlock(void)
+{
+    this->lockCount--;
+}
+
+inline bool SPIBus :: isLocked(void)
+{
+    return this->lockCount != 0;
+}
+
 
 #endif // __SPI_BUS_H
@@ -32,10 +32,55 @@
 #error STEPPER_CYCLE_US must be between 5ms and 100ms
 #endif
 
+#if STEPPER_STEP_HIGH_US < 0 || STEPPER_STEP_LOW_US < 0 || STEPPER_DIR_SETUP_US < 0 || STEPPER_DIR_HOLD_US < 0
+#error Step and direction times must not be negative
+#endif
+
+#if STEPPER_STEP_HIGH_US > 1000 || STEPPER_STEP_LOW_US > 1000 || STEPPER_DIR_SETUP_US > 1000 || STEPPER_DIR_HOLD_US > 1000
+#error Step and direction times must be no more than 1000us
+#endif
+
+#if defined(USE_CLA_ENGINE) && (STEPPER_STEP_HIGH_US > STEPPER_CYCLE_US || STEPPER_STEP_LOW_US > STEPPER_CYCLE_US || \
+        STEPPER_DIR_SETUP_US > STEPPER_CYCLE_US || STEPPER_DIR_HOLD_US > STEPPER_CYCLE_US)
+#error Step and direction times longer than STEPPER_CYCLE_US are not supported by the CLA engine
+#endif
+
+#if defined(USE_CLA_ENGINE) && defined(USE_IDLE_RATE)
+#error USE_IDLE_RATE is not supported by the CLA engine
+#endif
+
+#if STEPPER_IDLE_CYCLE_US < STEPPER_CYCLE_US || STEPPER_IDLE_CYCLE_US > 1000
+#error STEPPER_IDLE_CYCLE_US must be between STEPPER_CYCLE_US and 1000us
+#endif
+
+#if STEPPER_IDLE_DELAY_MS < 10 || STEPPER_IDLE_DELAY_MS > 10000
+#error STEPPER_IDLE_DELAY_MS must be between 10ms and 10000ms
+#endif
+
 #if UI_REFRESH_RATE_HZ < 3 || UI_REFRESH_RATE_HZ > 100
 #error UI_REFRESH_RATE_HZ must be between 1Hz and 100Hz
 #endif
 
+#if KEY_SCAN_RATE_HZ < 100 || KEY_SCAN_RATE_HZ > 1000 || 1000 % KEY_SCAN_RATE_HZ != 0
+#error KEY_SCAN_RATE_HZ must be between 100Hz and 1000Hz, and divide 1000
+#endif
+
+#if KEY_DEBOUNCE_MS * KEY_SCAN_RATE_HZ < 1000 || KEY_DEBOUNCE_MS > 50
+#error KEY_DEBOUNCE_MS must be at least one key scan, and at most 50ms
+#endif
+
+#if KEY_REPEAT_DELAY_MS < 100 || KEY_REPEAT_DELAY_MS > 2000
+#error KEY_REPEAT_DELAY_MS must be between 100ms and 2000ms
+#endif
+
+#if KEY_REPEAT_INTERVAL_MS < 1000 / UI_REFRESH_RATE_HZ || KEY_REPEAT_INTERVAL_MS > 1000
+#error KEY_REPEAT_INTERVAL_MS must be between one user interface loop and 1000ms
+#endif
+
+#if KEY_REPEAT_ACCELERATION < 0 || KEY_REPEAT_MAX_COUNT < 1 || KEY_REPEAT_MAX_COUNT > 10
+#error KEY_REPEAT_ACCELERATION must not be negative, and KEY_REPEAT_MAX_COUNT must be between 1 and 10
+#endif
+
 #if RPM_CALC_RATE_HZ < 1 || RPM_CALC_RATE_HZ > 10
 #error RPM_CALC_RATE_HZ must be between 1Hz and 10Hz
 #endif
@@ -52,10 +97,40 @@
 #error STEPPER_RESOLUTION must be between 100 and 2000
 #endif
 
+#if BACKLASH_STEPS < 0 || BACKLASH_STEPS > 1000
+#error BACKLASH_STEPS must be between 0 and 1000
+#endif
+
+#if BACKLASH_TAKEUP_RATE_HZ < 100 || BACKLASH_TAKEUP_RATE_HZ > 1000000 / STEPPER_CYCLE_US / 2
+#error BACKLASH_TAKEUP_RATE_HZ must be between 100Hz and half the stepper cycle rate
+#endif
+
+#if STOP_DECELERATION < 10000 || STOP_DECELERATION > 100000000
+#error STOP_DECELERATION must be between 10000 and 100000000 steps/s^2
+#endif
+
+#if JOG_MAX_RATE_HZ < 100 || JOG_MAX_RATE_HZ > 1000000 / STEPPER_CYCLE_US / 2
+#error JOG_MAX_RATE_HZ must be between 100Hz and half the stepper cycle rate
+#endif
+
+#if JOG_MIN_RATE_HZ < 100 || JOG_MIN_RATE_HZ >= JOG_MAX_RATE_HZ
+#error JOG_MIN_RATE_HZ must be at least 100Hz and below JOG_MAX_RATE_HZ
+#endif
+
+// below this, one ISR cycle's worth of acceleration is too few bits of a
+// 32-bit fraction of a step per cycle to hold the rate accurately
+#if JOG_ACCELERATION < 10000 || JOG_ACCELERATION > 10000000
+#error JOG_ACCELERATION must be between 10000 and 10000000 steps/s^2
+#endif
+
 #if ENCODER_RESOLUTION < 100 || ENCODER_RESOLUTION > 10000
 #error ENCODER_RESOLUTION must be between 100 and 10000
 #endif
 
+#if SPINDLE_DEADBAND_COUNTS < 0 || SPINDLE_DEADBAND_COUNTS > ENCODER_RESOLUTION / 64
+#error SPINDLE_DEADBAND_COUNTS must be between 0 and 1/64 of ENCODER_RESOLUTION
+#endif
+
 #if defined(LEADSCREW_TPI) && defined(LEADSCREW_HMM)
 #error LEADSCREW_TPI and LEADSCREW_HMM may not both be defined.  Choose only one.
 #endif
@@ -76,6 +151,120 @@
 #error Define only one of ENCODER_USE_EQEP1 or ENCODER_USE_EQEP2
 #endif
 
+#if defined(USE_CLA_ENGINE) && defined(USE_BROWNOUT_SNAPSHOT)
+#error USE_BROWNOUT_SNAPSHOT is not supported by the CLA engine
+#endif
+
+#if BROWNOUT_THRESHOLD < 1000 || BROWNOUT_THRESHOLD > 3800
+#error BROWNOUT_THRESHOLD must be between 1000 and 3800
+#endif
+
+#if defined(USE_CLA_ENGINE) && defined(USE_ALARM_LATCH)
+#error USE_ALARM_LATCH is not supported by the CLA engine
+#endif
+
+#if defined(USE_CLA_ENGINE) && defined(USE_MPG)
+#error USE_MPG is not supported by the CLA engine
+#endif
+
+#if MPG_DETENT_SHIFT < 0 || MPG_DETENT_SHIFT > 4
+#error MPG_DETENT_SHIFT must be between 0 and 4
+#endif
+
+#if MPG_MAX_RATE_HZ < 100 || MPG_MAX_RATE_HZ > 1000000 / STEPPER_CYCLE_US / 2
+#error MPG_MAX_RATE_HZ must be between 100Hz and half the stepper cycle rate
+#endif
+
+#if defined(USE_CLA_ENGINE) && defined(USE_THREADING_CYCLE)
+#error USE_THREADING_CYCLE is not supported by the CLA engine
+#endif
+
+#if PITCH_COMP_SHIFT < 4 || PITCH_COMP_SHIFT > 15
+#error PITCH_COMP_SHIFT must be between 4 and 15
+#endif
+
+#if defined(USE_CLA_ENGINE) && defined(USE_PITCH_COMPENSATION)
+#error USE_PITCH_COMPENSATION is not supported by the CLA engine
+#endif
+
+#if defined(USE_X_AXIS)
+#if defined(X_LEADSCREW_TPI) && defined(X_LEADSCREW_HMM)
+#error X_LEADSCREW_TPI and X_LEADSCREW_HMM may not both be defined.  Choose only one.
+#endif
+
+#if !defined(X_LEADSCREW_TPI) && !defined(X_LEADSCREW_HMM)
+#error Define one of X_LEADSCREW_TPI or X_LEADSCREW_HMM
+#endif
+
+#if X_STEPPER_MICROSTEPS < 1 || X_STEPPER_MICROSTEPS > 256
+#error X_STEPPER_MICROSTEPS must be between 1 and 256
+#endif
+
+#if X_STEPPER_RESOLUTION < 1 || X_STEPPER_RESOLUTION > 2000
+#error X_STEPPER_RESOLUTION must be between 100 and 2000
+#endif
+
+#if X_TAPER_NUMERATOR < 0 || X_TAPER_DENOMINATOR < 1
+#error X_TAPER_NUMERATOR must not be negative and X_TAPER_DENOMINATOR must be positive
+#endif
+
+#if defined(USE_CLA_ENGINE)
+#error USE_X_AXIS is not supported by the CLA engine
+#endif
+
+#if defined(USE_THREADING_CYCLE) && X_TAPER_NUMERATOR == 0
+#error USE_THREADING_CYCLE can not be used with power facing (X_TAPER_NUMERATOR 0)
+#endif
+#endif
+
+#if ENCODER_INDEX_TOLERANCE < 0 || ENCODER_INDEX_TOLERANCE > ENCODER_RESOLUTION / 8
+#error ENCODER_INDEX_TOLERANCE must be between 0 and one eighth of ENCODER_RESOLUTION
+#endif
+
+#if defined(USE_THREADING_CYCLE) && !defined(ENCODER_HAS_INDEX)
+#error USE_THREADING_CYCLE requires an encoder with an index output (ENCODER_HAS_INDEX)
+#endif
+
+#if defined(USE_DIVIDING_HEAD) && !defined(ENCODER_HAS_INDEX)
+#error USE_DIVIDING_HEAD requires an encoder with an index output (ENCODER_HAS_INDEX)
+#endif
+
+#if DIVIDING_MAX < 2 || DIVIDING_MAX > 999 || DIVIDING_MAX > ENCODER_RESOLUTION
+#error DIVIDING_MAX must be between 2 and 999, and no more than ENCODER_RESOLUTION
+#endif
+
+#if DIVIDING_DEFAULT < 2 || DIVIDING_DEFAULT > DIVIDING_MAX
+#error DIVIDING_DEFAULT must be between 2 and DIVIDING_MAX
+#endif
+
+#if SUPERVISOR_RATE_HZ < 20 || SUPERVISOR_RATE_HZ > 1000
+#error SUPERVISOR_RATE_HZ must be between 20Hz and 1000Hz
+#endif
+
+#if SUPERVISOR_LOOP_TIMEOUT_MS < 100 || SUPERVISOR_LOOP_TIMEOUT_MS > 5000
+#error SUPERVISOR_LOOP_TIMEOUT_MS must be between 100ms and 5000ms
+#endif
+
+#if defined(USE_CLA_ENGINE) && defined(USE_BLACKBOX)
+#error USE_BLACKBOX is not supported by the CLA engine
+#endif
+
+#if BLACKBOX_RATE_HZ < 100 || BLACKBOX_RATE_HZ > 10000
+#error BLACKBOX_RATE_HZ must be between 100Hz and 10000Hz
+#endif
+
+#if 1000000 / STEPPER_CYCLE_US / 2 / BLACKBOX_RATE_HZ > 127
+#error BLACKBOX_RATE_HZ is too low to record the fastest step rate; a sample holds at most 127 steps
+#endif
+
+#if ENCODER_RESOLUTION * 100 / BLACKBOX_RATE_HZ > 32767
+#error BLACKBOX_RATE_HZ is too low to record a 6000 RPM spindle with this ENCODER_RESOLUTION
+#endif
+
+#if BLACKBOX_SLOTS < 1 || BLACKBOX_SLOTS > 4
+#error BLACKBOX_SLOTS must be between 1 and 4
+#endif
+
 
 
 #endif // __SANITYCHECK_H
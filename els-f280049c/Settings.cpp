@@ -0,0 +1,83 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "Settings.h"
+
+
+Settings :: Settings(EEPROM *eeprom)
+{
+    this->eeprom = eeprom;
+    setDefaults();
+}
+
+void Settings :: setDefaults(void)
+{
+    for( Uint16 i=0; i < EEPROM_PAGE_SIZE; i++ ) {
+        this->page.all[i] = 0;
+    }
+    this->page.bit.signature = SETTINGS_SIGNATURE;
+    this->page.bit.version = SETTINGS_VERSION;
+    this->page.bit.backlashSteps = BACKLASH_STEPS;
+    this->page.bit.compiledBacklashSteps = BACKLASH_STEPS;
+}
+
+Uint16 Settings :: calculateChecksum(void)
+{
+    Uint16 sum = 0;
+
+    // everything but the checksum word itself
+    for( Uint16 i=0; i < EEPROM_PAGE_SIZE - 1; i++ ) {
+        sum += this->page.all[i];
+    }
+    return ~sum;
+}
+
+void Settings :: load(void)
+{
+    this->eeprom->readPage(EEPROM_SETTINGS_PAGE, this->page.all);
+
+    if( this->page.bit.signature != SETTINGS_SIGNATURE ||
+        this->page.bit.version != SETTINGS_VERSION ||
+        this->page.bit.checksum != calculateChecksum() )
+    {
+        // blank, corrupt or from an older firmware
+        setDefaults();
+        save();
+    }
+    else if( this->page.bit.compiledBacklashSteps != BACKLASH_STEPS )
+    {
+        // BACKLASH_STEPS was changed for this machine and reflashed
+        this->page.bit.backlashSteps = BACKLASH_STEPS;
+        this->page.bit.compiledBacklashSteps = BACKLASH_STEPS;
+        save();
+    }
+}
+
+void Settings :: save(void)
+{
+    this->page.bit.checksum = calculateChecksum();
+    this->eeprom->writePage(EEPROM_SETTINGS_PAGE, this->page.all);
+}
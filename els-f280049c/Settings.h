@@ -0,0 +1,98 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __SETTINGS_H
+#define __SETTINGS_H
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "EEPROM.h"
+
+
+// Identifies a page written by this firmware; bump the version whenever the
+// layout of SETTINGS_BITS changes so stale pages are replaced with defaults
+#define SETTINGS_SIGNATURE 0xE15A
+#define SETTINGS_VERSION 2
+
+// Most backlash that can be set from the panel, in steps
+#define SETTINGS_MAX_BACKLASH 1000
+
+struct SETTINGS_BITS
+{
+    Uint16 signature;
+    Uint16 version;
+    Uint16 backlashSteps;
+    Uint16 compiledBacklashSteps;   // BACKLASH_STEPS the backlash was seeded from
+    Uint16 reserved[3];
+    Uint16 checksum;
+};
+
+typedef union SETTINGS_PAGE
+{
+    Uint16 all[EEPROM_PAGE_SIZE];
+    struct SETTINGS_BITS bit;
+} SETTINGS_PAGE;
+
+
+class Settings
+{
+private:
+    EEPROM *eeprom;
+
+    // RAM copy of the persisted page
+    SETTINGS_PAGE page;
+
+    Uint16 calculateChecksum(void);
+    void setDefaults(void);
+
+public:
+    Settings(EEPROM *eeprom);
+
+    // read settings from EEPROM, falling back to defaults if the page is
+    // invalid, and re-seeding anything whose compiled default has changed
+    void load(void);
+
+    // write the current settings to EEPROM
+    void save(void);
+
+    Uint16 getBacklashSteps(void);
+
+    // change the backlash, up to SETTINGS_MAX_BACKLASH; save() keeps it
+    void setBacklashSteps(Uint16 steps);
+};
+
+inline Uint16 Settings :: getBacklashSteps(void)
+{
+    return this->page.bit.backlashSteps;
+}
+
+inline void Settings :: setBacklashSteps(Uint16 steps)
+{
+    this->page.bit.backlashSteps = (steps > SETTINGS_MAX_BACKLASH) ? SETTINGS_MAX_BACKLASH : steps;
+}
+
+
+#endif // __SETTINGS_H
@@ -0,0 +1,94 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "SlaveAxis.h"
+
+
+SlaveAxis :: SlaveAxis(StepperDrive *drive, Uint64 scaleNumerator, Uint64 scaleDenominator)
+{
+    this->drive = drive;
+
+    Uint64 divisor = gcd(scaleNumerator, scaleDenominator);
+    this->scaleNumerator = scaleNumerator / divisor;
+    this->scaleDenominator = scaleDenominator / divisor;
+
+#ifdef USE_FLOATING_POINT
+    this->ratio = 0;
+#else
+    this->numerator = 0;
+    this->denominator = 1;
+#endif // USE_FLOATING_POINT
+    this->direction = 1;
+
+    this->active = false;
+    this->resync = false;
+}
+
+Uint64 SlaveAxis :: gcd(Uint64 a, Uint64 b)
+{
+    while( b != 0 ) {
+        Uint64 t = a % b;
+        a = b;
+        b = t;
+    }
+    return (a == 0) ? 1 : a;
+}
+
+void SlaveAxis :: setFeed(const FEED_THREAD *feed)
+{
+    // hold still while the ratio is half-written
+    this->active = false;
+
+    if( feed == NULL ) {
+        return;
+    }
+
+    // cross-reduce before multiplying, to keep the products in 64 bits
+    Uint64 g1 = gcd(feed->numerator, this->scaleDenominator);
+    Uint64 g2 = gcd(this->scaleNumerator, feed->denominator);
+    Uint64 numerator = (feed->numerator / g1) * (this->scaleNumerator / g2);
+    Uint64 denominator = (feed->denominator / g2) * (this->scaleDenominator / g1);
+
+#ifdef USE_FLOATING_POINT
+    this->ratio = (float)numerator / denominator;
+#else
+    this->numerator = numerator;
+    this->denominator = denominator;
+#endif // USE_FLOATING_POINT
+
+    this->resync = true;
+    this->active = true;
+}
+
+void SlaveAxis :: setDirection(int16 direction)
+{
+    bool wasActive = this->active;
+
+    this->active = false;
+    this->direction = direction;
+    this->resync = true;
+    this->active = wasActive;
+}
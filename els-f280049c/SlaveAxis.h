@@ -0,0 +1,156 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __SLAVEAXIS_H
+#define __SLAVEAXIS_H
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "StepperDrive.h"
+#include "Tables.h"
+
+
+//
+// Steps per 10 inches (254mm) of travel, as fractions, for the leadscrew (Z)
+// and the cross slide (X)
+//
+#if defined(LEADSCREW_TPI)
+#define Z_STEPS_NUMERATOR ((Uint64)LEADSCREW_TPI*STEPPER_RESOLUTION*STEPPER_MICROSTEPS*10)
+#define Z_STEPS_DENOMINATOR ((Uint64)1)
+#endif
+#if defined(LEADSCREW_HMM)
+#define Z_STEPS_NUMERATOR ((Uint64)STEPPER_RESOLUTION*STEPPER_MICROSTEPS*25400)
+#define Z_STEPS_DENOMINATOR ((Uint64)LEADSCREW_HMM)
+#endif
+
+#if defined(X_LEADSCREW_TPI)
+#define X_STEPS_NUMERATOR ((Uint64)X_LEADSCREW_TPI*X_STEPPER_RESOLUTION*X_STEPPER_MICROSTEPS*10)
+#define X_STEPS_DENOMINATOR ((Uint64)1)
+#endif
+#if defined(X_LEADSCREW_HMM)
+#define X_STEPS_NUMERATOR ((Uint64)X_STEPPER_RESOLUTION*X_STEPPER_MICROSTEPS*25400)
+#define X_STEPS_DENOMINATOR ((Uint64)X_LEADSCREW_HMM)
+#endif
+
+//
+// Cross slide steps per leadscrew step for the same travel, times the taper
+//
+#if X_TAPER_NUMERATOR == 0
+#define X_SCALE_NUMERATOR (X_STEPS_NUMERATOR * Z_STEPS_DENOMINATOR)
+#define X_SCALE_DENOMINATOR (X_STEPS_DENOMINATOR * Z_STEPS_NUMERATOR)
+#else
+#define X_SCALE_NUMERATOR (X_STEPS_NUMERATOR * Z_STEPS_DENOMINATOR * X_TAPER_NUMERATOR)
+#define X_SCALE_DENOMINATOR (X_STEPS_DENOMINATOR * Z_STEPS_NUMERATOR * X_TAPER_DENOMINATOR)
+#endif
+
+
+//
+// An additional stepper axis slaved to the spindle
+//
+// The axis follows the leadscrew feed, scaled by a fixed ratio of its own
+// steps per leadscrew step.  Core steps every slave axis in the same ISR as
+// the leadscrew, at a fixed cost per axis.
+//
+class SlaveAxis
+{
+private:
+    StepperDrive *drive;
+
+    // slave steps per leadscrew step
+    Uint64 scaleNumerator;
+    Uint64 scaleDenominator;
+
+    // slave steps per encoder count
+#ifdef USE_FLOATING_POINT
+    float ratio;
+#else
+    Uint64 numerator;
+    Uint64 denominator;
+#endif // USE_FLOATING_POINT
+    int16 direction;
+
+    // hold still while the ratio changes, and resync when it has
+    bool active;
+    bool resync;
+
+    static Uint64 gcd(Uint64 a, Uint64 b);
+
+public:
+    SlaveAxis(StepperDrive *drive, Uint64 scaleNumerator, Uint64 scaleDenominator);
+
+    // follow a leadscrew feed; NULL stops the axis
+    void setFeed(const FEED_THREAD *feed);
+
+    // follow the leadscrew forward (+1) or in reverse (-1)
+    void setDirection(int16 direction);
+
+    StepperDrive *getDrive(void);
+
+    int32 feedRatio(Uint32 count);
+
+    // wrap is +1 or -1 if the encoder count wrapped since the last cycle
+    void ISR(Uint32 spindlePosition, int16 wrap, Uint32 maxCount);
+};
+
+inline StepperDrive *SlaveAxis :: getDrive(void)
+{
+    return this->drive;
+}
+
+inline int32 SlaveAxis :: feedRatio(Uint32 count)
+{
+#ifdef USE_FLOATING_POINT
+    return ((float)count) * this->ratio * this->direction;
+#else // USE_FLOATING_POINT
+    return ((long long)count) * this->numerator / this->denominator * this->direction;
+#endif // USE_FLOATING_POINT
+}
+
+#pragma CODE_SECTION("hotfuncs")
+inline void SlaveAxis :: ISR(Uint32 spindlePosition, int16 wrap, Uint32 maxCount)
+{
+    if( this->active ) {
+        int32 desiredSteps = feedRatio(spindlePosition);
+        drive->setDesiredPosition(desiredSteps);
+
+        if( wrap != 0 ) {
+            drive->incrementCurrentPosition(wrap * feedRatio(maxCount));
+        }
+
+        if( this->resync ) {
+            drive->setCurrentPosition(desiredSteps);
+            this->resync = false;
+        }
+    }
+    else {
+        drive->setCurrentPosition(drive->getDesiredPosition());
+    }
+
+    drive->ISR();
+}
+
+
+#endif // __SLAVEAXIS_H
@@ -25,10 +25,33 @@
 
 
 #include "StepperDrive.h"
+#include <math.h>
 
 
-StepperDrive :: StepperDrive(void)
+StepperDrive :: StepperDrive(const STEPPER_PINS *pins)
 {
+    //
+    // Work out which register drives each output active and inactive
+    //
+    volatile Uint32 *set = &GpioDataRegs.GPASET.all;
+    volatile Uint32 *clear = &GpioDataRegs.GPACLEAR.all;
+
+    this->stepMask = pins->step;
+    this->directionMask = pins->direction;
+    this->enableMask = pins->enable;
+    this->alarmMask = pins->alarm;
+
+    bool invertStep = pins->invert & STEPPER_INVERT_STEP;
+    bool invertDirection = pins->invert & STEPPER_INVERT_DIRECTION;
+    bool invertEnable = pins->invert & STEPPER_INVERT_ENABLE;
+    this->stepOn = invertStep ? clear : set;
+    this->stepOff = invertStep ? set : clear;
+    this->directionOn = invertDirection ? clear : set;
+    this->directionOff = invertDirection ? set : clear;
+    this->enableOn = invertEnable ? clear : set;
+    this->enableOff = invertEnable ? set : clear;
+    this->alarmActiveLow = pins->invert & STEPPER_INVERT_ALARM;
+
     //
     // Set up global state variables
     //
@@ -39,35 +62,110 @@ StepperDrive :: StepperDrive(void)
     // State machine starts at state zero
     //
     this->state = 0;
+    this->pulseDelay = 0;
+
+    //
+    // No backlash compensation until it is configured
+    //
+    this->backlash = 0;
+    this->takeupSteps = 0;
+    this->takeupDelay = 0;
+
+    //
+    // Carriage position is relative to wherever it was at power-up
+    //
+    this->carriagePosition = 0;
+    this->limited = false;
+    this->minPosition = 0;
+    this->maxPosition = 0;
+    this->stopPosition = 0;
+    this->rampDelay = 0;
+
+    //
+    // Outputs stay off until initHardware()
+    //
+    this->enabled = false;
+
+    //
+    // Precompute the deceleration ramp: at constant deceleration a, the
+    // speed with d steps left is sqrt(2*a*d) steps/s.  Index zero is never
+    // used to time a step, since the drive is parked there.
+    //
+    this->rampCycles[0] = 0;
+    for( Uint16 d=1; d < STOP_RAMP_STEPS; d++ ) {
+        float stepsPerSecond = sqrtf(2.0f * STOP_DECELERATION * d);
+        this->rampCycles[d] = (Uint16)(1000000.0f / STEPPER_CYCLE_US / stepsPerSecond);
+    }
 }
 
 void StepperDrive :: initHardware(void)
 {
     //
-    // Configure GPIO pins for output
-    // GPIO0 = Step
-    // GPIO1 = Direction
-    // GPIO6 - Enable
-    // GPIO
+    // Configure GPIO pins: step, direction and enable are outputs, and the
+    // alarm is an input
     //
     EALLOW;
-    GpioCtrlRegs.GPAMUX1.bit.GPIO0 = 0;
-    GpioCtrlRegs.GPAMUX1.bit.GPIO1 = 0;
-    GpioCtrlRegs.GPAMUX1.bit.GPIO6 = 0;
-    GpioCtrlRegs.GPAMUX1.bit.GPIO7 = 0;
-
-    GpioCtrlRegs.GPADIR.bit.GPIO0 = 1;
-    GpioCtrlRegs.GPADIR.bit.GPIO1 = 1;
-    GpioCtrlRegs.GPADIR.bit.GPIO6 = 1;
-    GpioCtrlRegs.GPADIR.bit.GPIO7 = 0; // input
-
-    GPIO_CLEAR_STEP;
-    GPIO_CLEAR_DIRECTION;
+    Uint32 outputs = this->stepMask | this->directionMask | this->enableMask;
+    selectGpio(outputs | this->alarmMask);
+    GpioCtrlRegs.GPADIR.all |= outputs;
+    GpioCtrlRegs.GPADIR.all &= ~this->alarmMask;
+
+    *this->stepOff = this->stepMask;
+    *this->directionOff = this->directionMask;
     EDIS;
 
     setEnabled(true);
 }
 
+void StepperDrive :: selectGpio(Uint32 mask)
+{
+    // plain GPIO function on every pin in the mask
+    for( Uint16 pin=0; pin < 32; pin++ ) {
+        if( mask & GPIO_MASK(pin) ) {
+            Uint32 muxBits = 3UL << ((pin % 16) * 2);
+            if( pin < 16 ) {
+                GpioCtrlRegs.GPAMUX1.all &= ~muxBits;
+                GpioCtrlRegs.GPAGMUX1.all &= ~muxBits;
+            }
+            else {
+                GpioCtrlRegs.GPAMUX2.all &= ~muxBits;
+                GpioCtrlRegs.GPAGMUX2.all &= ~muxBits;
+            }
+        }
+    }
+}
+
+void StepperDrive :: setStop(int32 position)
+{
+    bool above = (position > this->carriagePosition) ||
+            (position == this->carriagePosition && (this->state & 1));
+
+    this->stopPosition = position;
+
+    if( above ) {
+        setLimits(-STOP_NO_LIMIT, position);
+    }
+    else {
+        setLimits(position, STOP_NO_LIMIT);
+    }
+}
+
+void StepperDrive :: setLimits(int32 minPosition, int32 maxPosition)
+{
+    // disarm while the limits change, so the ISR never sees half an update
+    this->limited = false;
+
+    this->minPosition = minPosition;
+    this->maxPosition = maxPosition;
+
+    this->limited = true;
+}
+
+void StepperDrive :: clearStop(void)
+{
+    this->limited = false;
+}
+
 
 
 
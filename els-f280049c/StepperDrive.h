@@ -29,51 +29,53 @@
 
 #include "F28x_Project.h"
 #include "Configuration.h"
+#include "StepperPins.h"
 
 
-#define STEP_PIN GPIO0
-#define DIRECTION_PIN GPIO1
-#define ENABLE_PIN GPIO6
-#define ALARM_PIN GPIO7
-
-#define GPIO_SET(pin) GpioDataRegs.GPASET.bit.pin = 1
-#define GPIO_CLEAR(pin) GpioDataRegs.GPACLEAR.bit.pin = 1
-#define GPIO_GET(pin) GpioDataRegs.GPADAT.bit.pin
-
-#ifdef INVERT_STEP_PIN
-#define GPIO_SET_STEP GPIO_CLEAR(STEP_PIN)
-#define GPIO_CLEAR_STEP GPIO_SET(STEP_PIN)
-#else
-#define GPIO_SET_STEP GPIO_SET(STEP_PIN)
-#define GPIO_CLEAR_STEP GPIO_CLEAR(STEP_PIN)
-#endif
-
-#ifdef INVERT_DIRECTION_PIN
-#define GPIO_SET_DIRECTION GPIO_CLEAR(DIRECTION_PIN)
-#define GPIO_CLEAR_DIRECTION GPIO_SET(DIRECTION_PIN)
-#else
-#define GPIO_SET_DIRECTION GPIO_SET(DIRECTION_PIN)
-#define GPIO_CLEAR_DIRECTION GPIO_CLEAR(DIRECTION_PIN)
-#endif
-
-#ifdef INVERT_ENABLE_PIN
-#define GPIO_SET_ENABLE GPIO_CLEAR(ENABLE_PIN)
-#define GPIO_CLEAR_ENABLE GPIO_SET(ENABLE_PIN)
-#else
-#define GPIO_SET_ENABLE GPIO_SET(ENABLE_PIN)
-#define GPIO_CLEAR_ENABLE GPIO_CLEAR(ENABLE_PIN)
-#endif
-
-#ifdef INVERT_ALARM_PIN
-#define GPIO_GET_ALARM (GPIO_GET(ALARM_PIN) == 0)
-#else
-#define GPIO_GET_ALARM (GPIO_GET(ALARM_PIN) != 0)
-#endif
+// ISR cycles between backlash take-up steps
+#define BACKLASH_TAKEUP_CYCLES (1000000 / STEPPER_CYCLE_US / BACKLASH_TAKEUP_RATE_HZ)
+
+// ISR cycles for each part of the step and direction timing, rounded up.  A
+// step is high for at least one cycle and low for at least one; the low time
+// also covers whatever direction hold time the high time does not.  With no
+// direction setup time, a reversal and its first step share a cycle.
+#define _STEPPER_CYCLES(us) (((us) + STEPPER_CYCLE_US - 1) / STEPPER_CYCLE_US)
+#define _AT_LEAST_ONE(cycles) ((cycles) > 1 ? (cycles) : 1)
+#define STEP_HIGH_CYCLES _AT_LEAST_ONE(_STEPPER_CYCLES(STEPPER_STEP_HIGH_US))
+#define _STEP_HOLD_CYCLES (_STEPPER_CYCLES(STEPPER_DIR_HOLD_US) - STEP_HIGH_CYCLES)
+#define _STEP_LOW_CYCLES _STEPPER_CYCLES(STEPPER_STEP_LOW_US)
+#define STEP_LOW_CYCLES _AT_LEAST_ONE(_STEP_LOW_CYCLES > _STEP_HOLD_CYCLES ? _STEP_LOW_CYCLES : _STEP_HOLD_CYCLES)
+#define DIR_SETUP_CYCLES _STEPPER_CYCLES(STEPPER_DIR_SETUP_US)
+
+// Number of steps before a stop over which the drive decelerates
+#define STOP_RAMP_STEPS 64
+
+// Limit used for the open side of a stop; far enough out to never be reached,
+// but small enough that distances to it cannot overflow
+#define STOP_NO_LIMIT 0x3FFFFFFFL
 
 
 class StepperDrive
 {
 private:
+    //
+    // Pins, as GPIO port A masks, and the registers that drive each output
+    // to its active and inactive level
+    //
+    Uint32 stepMask;
+    Uint32 directionMask;
+    Uint32 enableMask;
+    Uint32 alarmMask;
+    volatile Uint32 *stepOn;
+    volatile Uint32 *stepOff;
+    volatile Uint32 *directionOn;
+    volatile Uint32 *directionOff;
+    volatile Uint32 *enableOn;
+    volatile Uint32 *enableOff;
+    bool alarmActiveLow;
+
+    void selectGpio(Uint32 mask);
+
     //
     // Current position of the motor, in steps
     //
@@ -88,19 +90,77 @@ private:
     // current state-machine state
     // bit 0 - step signal
     // bit 1 - direction signal
+    // bit 2 - backlash take-up step
     //
     Uint16 state;
 
+    //
+    // ISR cycles to hold the outputs as they are, to meet the drive's step
+    // and direction timing
+    //
+    Uint16 pulseDelay;
+
+    bool advance(void);
+
+    //
+    // Backlash in the leadscrew and gear train, in steps
+    //
+    Uint16 backlash;
+
+    //
+    // Take-up steps still owed since the last direction change, and ISR
+    // cycles to wait before the next one
+    //
+    Uint16 takeupSteps;
+    Uint16 takeupDelay;
+
+    void reverseBacklash(void);
+    bool isTakeupDue(void);
+
+    //
+    // Absolute carriage position, in steps.  Unlike currentPosition, this
+    // only changes when the motor actually moves, so it survives feed changes.
+    //
+    int32 carriagePosition;
+
+    //
+    // Soft travel limits, in carriage steps, and whether they are active
+    //
+    int32 minPosition;
+    int32 maxPosition;
+    bool limited;
+
+    //
+    // Position of the operator's stop, in carriage steps
+    //
+    int32 stopPosition;
+
+    //
+    // Deceleration ramp approaching a limit: minimum ISR cycles between steps,
+    // indexed by the number of steps left, and the cycles left to wait
+    //
+    Uint16 rampCycles[STOP_RAMP_STEPS];
+    Uint16 rampDelay;
+
+    void applyLimits(void);
+    Uint16 rampDelayFor(int32 stepsLeft);
+
     //
     // Is the drive enabled?
     //
     bool enabled;
 
 public:
-    StepperDrive();
+    StepperDrive(const STEPPER_PINS *pins);
     void initHardware(void);
 
     void setDesiredPosition(int32 steps);
+    int32 getDesiredPosition(void);
+    int32 getCurrentPosition(void);
+    bool isAtDesiredPosition(void);
+
+    // at rest: no step owed or being output, and nothing to take up
+    bool isIdle(void);
     void incrementCurrentPosition(int32 increment);
     void setCurrentPosition(int32 position);
 
@@ -110,6 +170,22 @@ public:
 
     bool isAlarm();
 
+    void setBacklash(Uint16 steps);
+
+    int32 getCarriagePosition(void);
+    void setCarriagePosition(int32 position);
+
+    // stop at the given carriage position; a stop at the current position
+    // blocks the direction the carriage was last moving
+    void setStop(int32 position);
+    void clearStop(void);
+    bool isStopSet(void);
+    bool isAtStop(void);
+    int32 getStopPosition(void);
+
+    // confine the carriage between two positions; used by the threading cycle
+    void setLimits(int32 minPosition, int32 maxPosition);
+
     void ISR(void);
 };
 
@@ -118,6 +194,30 @@ inline void StepperDrive :: setDesiredPosition(int32 steps)
     this->desiredPosition = steps;
 }
 
+inline int32 StepperDrive :: getDesiredPosition(void)
+{
+    return this->desiredPosition;
+}
+
+inline int32 StepperDrive :: getCurrentPosition(void)
+{
+    return this->currentPosition;
+}
+
+inline bool StepperDrive :: isAtDesiredPosition(void)
+{
+    return this->desiredPosition == this->currentPosition;
+}
+
+#pragma CODE_SECTION("hotfuncs")
+inline bool StepperDrive :: isIdle(void)
+{
+    // states 2, 3, 6 and 7 have the step output high
+    return ! this->enabled ||
+            (this->desiredPosition == this->currentPosition && this->takeupSteps == 0 &&
+             this->pulseDelay == 0 && (this->state & 2) == 0);
+}
+
 inline void StepperDrive :: incrementCurrentPosition(int32 increment)
 {
     this->currentPosition += increment;
@@ -141,67 +241,219 @@ inline void StepperDrive :: setEnabled(bool enabled)
 {
     this->enabled = enabled;
     if( this->enabled ) {
-        GPIO_SET_ENABLE;
+        *this->enableOn = this->enableMask;
     }
     else
     {
-        GPIO_CLEAR_ENABLE;
+        *this->enableOff = this->enableMask;
+    }
+}
+
+inline void StepperDrive :: setBacklash(Uint16 steps)
+{
+    this->backlash = steps;
+}
+
+#pragma CODE_SECTION("hotfuncs")
+inline void StepperDrive :: reverseBacklash(void)
+{
+    // whatever slack was already taken up in the old direction now has to be
+    // taken up again in the new one
+    this->takeupSteps = (this->takeupSteps < this->backlash) ? this->backlash - this->takeupSteps : 0;
+}
+
+#pragma CODE_SECTION("hotfuncs")
+inline bool StepperDrive :: isTakeupDue(void)
+{
+    if( this->takeupSteps == 0 ) {
+        return false;
     }
+    if( this->takeupDelay > 0 ) {
+        this->takeupDelay--;
+        return false;
+    }
+
+    // real steps take priority when the backlog is building, so the take-up
+    // never pushes it over MAX_BUFFERED_STEPS
+    int32 backlog = this->desiredPosition - this->currentPosition;
+    if( backlog < 0 ) backlog = -backlog;
+    return backlog < MAX_BUFFERED_STEPS / 2;
+}
+
+inline int32 StepperDrive :: getCarriagePosition(void)
+{
+    return this->carriagePosition;
+}
+
+inline void StepperDrive :: setCarriagePosition(int32 position)
+{
+    this->carriagePosition = position;
+}
+
+inline bool StepperDrive :: isStopSet(void)
+{
+    return this->limited;
+}
+
+inline int32 StepperDrive :: getStopPosition(void)
+{
+    return this->stopPosition;
+}
+
+inline bool StepperDrive :: isAtStop(void)
+{
+    return this->limited &&
+            (this->carriagePosition == this->minPosition || this->carriagePosition == this->maxPosition);
+}
+
+#pragma CODE_SECTION("hotfuncs")
+inline void StepperDrive :: applyLimits(void)
+{
+    // never buffer more steps than there is room for before a limit; anything
+    // beyond the stop is dropped, so the drive parks there while the spindle turns
+    int32 backlog = this->desiredPosition - this->currentPosition;
+    int32 ahead = this->maxPosition - this->carriagePosition;
+    int32 behind = this->minPosition - this->carriagePosition;
+
+    if( backlog > ahead ) {
+        this->currentPosition = this->desiredPosition - ahead;
+    }
+    else if( backlog < behind ) {
+        this->currentPosition = this->desiredPosition - behind;
+    }
+}
+
+#pragma CODE_SECTION("hotfuncs")
+inline Uint16 StepperDrive :: rampDelayFor(int32 stepsLeft)
+{
+    // a stop moved or set behind the carriage leaves nothing to ramp down for
+    return (stepsLeft > 0 && stepsLeft < STOP_RAMP_STEPS) ? this->rampCycles[stepsLeft] : 0;
 }
 
 inline bool StepperDrive :: isAlarm()
 {
-#ifdef USE_ALARM_PIN
-    return GPIO_GET_ALARM;
-#else
-    return false;
-#endif
+    if( this->alarmMask == 0 ) {
+        return false;
+    }
+    bool high = (GpioDataRegs.GPADAT.all & this->alarmMask) != 0;
+    return high != this->alarmActiveLow;
 }
 
 
+#pragma CODE_SECTION("hotfuncs")
+inline bool StepperDrive :: advance(void)
+{
+    // move the state machine on one step; true if the direction changed
+    switch( this->state ) {
+
+    case 0:
+        // Step = 0; Dir = 0
+        if( isTakeupDue() ) {
+            *this->stepOn = this->stepMask;
+            this->pulseDelay = STEP_HIGH_CYCLES - 1;
+            this->state = 6;
+        }
+        else if( this->desiredPosition < this->currentPosition && this->rampDelay == 0 ) {
+            *this->stepOn = this->stepMask;
+            this->pulseDelay = STEP_HIGH_CYCLES - 1;
+            this->state = 2;
+        }
+        else if( this->desiredPosition > this->currentPosition ) {
+            *this->directionOn = this->directionMask;
+            reverseBacklash();
+            this->pulseDelay = (DIR_SETUP_CYCLES > 0) ? DIR_SETUP_CYCLES - 1 : 0;
+            this->state = 1;
+            return true;
+        }
+        break;
+
+    case 1:
+        // Step = 0; Dir = 1
+        if( isTakeupDue() ) {
+            *this->stepOn = this->stepMask;
+            this->pulseDelay = STEP_HIGH_CYCLES - 1;
+            this->state = 7;
+        }
+        else if( this->desiredPosition > this->currentPosition && this->rampDelay == 0 ) {
+            *this->stepOn = this->stepMask;
+            this->pulseDelay = STEP_HIGH_CYCLES - 1;
+            this->state = 3;
+        }
+        else if( this->desiredPosition < this->currentPosition ) {
+            *this->directionOff = this->directionMask;
+            reverseBacklash();
+            this->pulseDelay = (DIR_SETUP_CYCLES > 0) ? DIR_SETUP_CYCLES - 1 : 0;
+            this->state = 0;
+            return true;
+        }
+        break;
+
+    case 2:
+        // Step = 1; Dir = 0
+        *this->stepOff = this->stepMask;
+        this->currentPosition--;
+        this->carriagePosition--;
+        if( this->limited ) {
+            this->rampDelay = rampDelayFor(this->carriagePosition - this->minPosition);
+        }
+        this->pulseDelay = STEP_LOW_CYCLES - 1;
+        this->state = 0;
+        break;
+
+    case 3:
+        // Step = 1; Dir = 1
+        *this->stepOff = this->stepMask;
+        this->currentPosition++;
+        this->carriagePosition++;
+        if( this->limited ) {
+            this->rampDelay = rampDelayFor(this->maxPosition - this->carriagePosition);
+        }
+        this->pulseDelay = STEP_LOW_CYCLES - 1;
+        this->state = 1;
+        break;
+
+    case 6:
+        // Step = 1; Dir = 0; take-up step, position unchanged
+        *this->stepOff = this->stepMask;
+        this->takeupSteps--;
+        this->takeupDelay = BACKLASH_TAKEUP_CYCLES;
+        this->pulseDelay = STEP_LOW_CYCLES - 1;
+        this->state = 0;
+        break;
+
+    case 7:
+        // Step = 1; Dir = 1; take-up step, position unchanged
+        *this->stepOff = this->stepMask;
+        this->takeupSteps--;
+        this->takeupDelay = BACKLASH_TAKEUP_CYCLES;
+        this->pulseDelay = STEP_LOW_CYCLES - 1;
+        this->state = 1;
+        break;
+    }
+
+    return false;
+}
+
+#pragma CODE_SECTION("hotfuncs")
 inline void StepperDrive :: ISR(void)
 {
     if(enabled) {
 
-        switch( this->state ) {
-
-        case 0:
-            // Step = 0; Dir = 0
-            if( this->desiredPosition < this->currentPosition ) {
-                GPIO_SET_STEP;
-                this->state = 2;
-            }
-            else if( this->desiredPosition > this->currentPosition ) {
-                GPIO_SET_DIRECTION;
-                this->state = 1;
-            }
-            break;
-
-        case 1:
-            // Step = 0; Dir = 1
-            if( this->desiredPosition > this->currentPosition ) {
-                GPIO_SET_STEP;
-                this->state = 3;
-            }
-            else if( this->desiredPosition < this->currentPosition ) {
-                GPIO_CLEAR_DIRECTION;
-                this->state = 0;
-            }
-            break;
-
-        case 2:
-            // Step = 1; Dir = 0
-            GPIO_CLEAR_STEP;
-            this->currentPosition--;
-            this->state = 0;
-            break;
+        if( this->limited ) {
+            applyLimits();
+        }
 
-        case 3:
-            // Step = 1; Dir = 1
-            GPIO_CLEAR_STEP;
-            this->currentPosition++;
-            this->state = 1;
-            break;
+        if( this->rampDelay > 0 ) {
+            this->rampDelay--;
+        }
+
+        if( this->pulseDelay > 0 ) {
+            this->pulseDelay--;
+        }
+        else if( advance() && DIR_SETUP_CYCLES == 0 ) {
+            // the drive needs no setup time, so the first step in the new
+            // direction goes out in the same cycle
+            advance();
         }
 
     } else {
@@ -0,0 +1,167 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __STEPPERPINS_H
+#define __STEPPERPINS_H
+
+//
+// Stepper driver pin assignments and polarity
+//
+// Plain C, so it can be shared with the CLA engine.
+//
+
+#include "Configuration.h"
+
+
+#define STEP_PIN GPIO0
+#define DIRECTION_PIN GPIO1
+#define ENABLE_PIN GPIO6
+#define ALARM_PIN GPIO7
+
+#define GPIO_SET(pin) GpioDataRegs.GPASET.bit.pin = 1
+#define GPIO_CLEAR(pin) GpioDataRegs.GPACLEAR.bit.pin = 1
+#define GPIO_GET(pin) GpioDataRegs.GPADAT.bit.pin
+
+#ifdef INVERT_STEP_PIN
+#define GPIO_SET_STEP GPIO_CLEAR(STEP_PIN)
+#define GPIO_CLEAR_STEP GPIO_SET(STEP_PIN)
+#else
+#define GPIO_SET_STEP GPIO_SET(STEP_PIN)
+#define GPIO_CLEAR_STEP GPIO_CLEAR(STEP_PIN)
+#endif
+
+#ifdef INVERT_DIRECTION_PIN
+#define GPIO_SET_DIRECTION GPIO_CLEAR(DIRECTION_PIN)
+#define GPIO_CLEAR_DIRECTION GPIO_SET(DIRECTION_PIN)
+#else
+#define GPIO_SET_DIRECTION GPIO_SET(DIRECTION_PIN)
+#define GPIO_CLEAR_DIRECTION GPIO_CLEAR(DIRECTION_PIN)
+#endif
+
+#ifdef INVERT_ENABLE_PIN
+#define GPIO_SET_ENABLE GPIO_CLEAR(ENABLE_PIN)
+#define GPIO_CLEAR_ENABLE GPIO_SET(ENABLE_PIN)
+#else
+#define GPIO_SET_ENABLE GPIO_SET(ENABLE_PIN)
+#define GPIO_CLEAR_ENABLE GPIO_CLEAR(ENABLE_PIN)
+#endif
+
+#ifdef INVERT_ALARM_PIN
+#define GPIO_GET_ALARM (GPIO_GET(ALARM_PIN) == 0)
+#else
+#define GPIO_GET_ALARM (GPIO_GET(ALARM_PIN) != 0)
+#endif
+
+
+
+//
+// Pin set for one stepper axis, as GPIO port A masks
+//
+typedef struct STEPPER_PINS
+{
+    Uint32 step;
+    Uint32 direction;
+    Uint32 enable;
+    Uint32 alarm;       // zero if there is no alarm input
+    Uint16 invert;      // STEPPER_INVERT_* bits
+} STEPPER_PINS;
+
+#define STEPPER_INVERT_STEP 1
+#define STEPPER_INVERT_DIRECTION (1<<1)
+#define STEPPER_INVERT_ENABLE (1<<2)
+#define STEPPER_INVERT_ALARM (1<<3)
+
+#define GPIO_MASK(n) (1UL << (n))
+
+
+//
+// Leadscrew (Z axis), on the pins above
+//
+#ifdef INVERT_STEP_PIN
+#define Z_INVERT_STEP STEPPER_INVERT_STEP
+#else
+#define Z_INVERT_STEP 0
+#endif
+#ifdef INVERT_DIRECTION_PIN
+#define Z_INVERT_DIRECTION STEPPER_INVERT_DIRECTION
+#else
+#define Z_INVERT_DIRECTION 0
+#endif
+#ifdef INVERT_ENABLE_PIN
+#define Z_INVERT_ENABLE STEPPER_INVERT_ENABLE
+#else
+#define Z_INVERT_ENABLE 0
+#endif
+#ifdef INVERT_ALARM_PIN
+#define Z_INVERT_ALARM STEPPER_INVERT_ALARM
+#else
+#define Z_INVERT_ALARM 0
+#endif
+#ifdef USE_ALARM_PIN
+#define Z_ALARM_MASK GPIO_MASK(7)
+#else
+#define Z_ALARM_MASK 0
+#endif
+
+#define Z_STEPPER_PINS { GPIO_MASK(0), GPIO_MASK(1), GPIO_MASK(6), Z_ALARM_MASK, \
+    Z_INVERT_STEP | Z_INVERT_DIRECTION | Z_INVERT_ENABLE | Z_INVERT_ALARM }
+
+
+//
+// Cross slide (X axis)
+// GPIO4 = Step, GPIO5 = Direction, GPIO8 = Enable, GPIO9 = Alarm
+//
+#ifdef X_INVERT_STEP_PIN
+#define X_INVERT_STEP STEPPER_INVERT_STEP
+#else
+#define X_INVERT_STEP 0
+#endif
+#ifdef X_INVERT_DIRECTION_PIN
+#define X_INVERT_DIRECTION STEPPER_INVERT_DIRECTION
+#else
+#define X_INVERT_DIRECTION 0
+#endif
+#ifdef X_INVERT_ENABLE_PIN
+#define X_INVERT_ENABLE STEPPER_INVERT_ENABLE
+#else
+#define X_INVERT_ENABLE 0
+#endif
+#ifdef X_INVERT_ALARM_PIN
+#define X_INVERT_ALARM STEPPER_INVERT_ALARM
+#else
+#define X_INVERT_ALARM 0
+#endif
+#ifdef X_USE_ALARM_PIN
+#define X_ALARM_MASK GPIO_MASK(9)
+#else
+#define X_ALARM_MASK 0
+#endif
+
+#define X_STEPPER_PINS { GPIO_MASK(4), GPIO_MASK(5), GPIO_MASK(8), X_ALARM_MASK, \
+    X_INVERT_STEP | X_INVERT_DIRECTION | X_INVERT_ENABLE | X_INVERT_ALARM }
+
+
+#endif // __STEPPERPINS_H
@@ -0,0 +1,158 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "Supervisor.h"
+
+
+// Supervisor ticks the loop may go without progress
+#define LOOP_TIMEOUT_TICKS (SUPERVISOR_LOOP_TIMEOUT_MS * SUPERVISOR_RATE_HZ / 1000)
+
+
+Supervisor :: Supervisor(EEPROM *eeprom, ControlPanel *controlPanel, Core *core)
+{
+    this->eeprom = eeprom;
+    this->controlPanel = controlPanel;
+    this->core = core;
+
+    this->previousIsrCount = 0;
+    this->loopCount = 0;
+    this->previousLoopCount = 0;
+    this->loopIdleTicks = 0;
+
+    this->faulted = false;
+}
+
+Uint16 Supervisor :: calculateChecksum(FAULT_PAGE *page)
+{
+    Uint16 sum = 0;
+
+    // everything but the checksum word itself
+    for( Uint16 i=0; i < EEPROM_PAGE_SIZE - 1; i++ ) {
+        sum += page->all[i];
+    }
+    return ~sum;
+}
+
+Uint16 Supervisor :: checkFault(void)
+{
+    FAULT_PAGE page;
+    Uint16 cause = FAULT_NONE;
+
+    this->eeprom->readPage(EEPROM_FAULT_PAGE, page.all);
+
+    if( page.bit.signature == FAULT_SIGNATURE && page.bit.checksum == calculateChecksum(&page) ) {
+        cause = page.bit.cause;
+
+        // report it once
+        for( Uint16 i=0; i < EEPROM_PAGE_SIZE; i++ ) {
+            page.all[i] = 0;
+        }
+        this->eeprom->writePage(EEPROM_FAULT_PAGE, page.all);
+    }
+    else if( CpuSysRegs.RESC.bit.WDRSn ) {
+        cause = FAULT_WATCHDOG;
+    }
+
+    EALLOW;
+    CpuSysRegs.RESCCLR.bit.WDRSn = 1;
+    EDIS;
+
+    return cause;
+}
+
+void Supervisor :: initHardware(void)
+{
+    this->previousIsrCount = CpuTimer0.InterruptCount;
+    this->previousLoopCount = this->loopCount;
+
+    ConfigCpuTimer(&CpuTimer1, CPU_CLOCK_MHZ, 1000000 / SUPERVISOR_RATE_HZ);
+    CpuTimer1Regs.TCR.all = 0x4001;         // start, with the interrupt enabled
+
+    EALLOW;
+    WdRegs.SCSR.bit.WDENINT = 0;            // a watchdog timeout resets the CPU
+    WdRegs.WDCR.all = 0x002C;               // enable, WDCLK = INTOSC/512/8: ~105ms timeout
+    EDIS;
+    ServiceDog();
+}
+
+void Supervisor :: fault(Uint16 cause)
+{
+    FAULT_PAGE page;
+    Uint32 isrCount = CpuTimer0.InterruptCount;
+
+    // drives off first, with nothing left to step them
+    PieCtrlRegs.PIEIER1.bit.INTx7 = 0;
+    core->setPowerOn(false);
+    this->faulted = true;
+
+    for( Uint16 i=0; i < EEPROM_PAGE_SIZE; i++ ) {
+        page.all[i] = 0;
+    }
+    page.bit.signature = FAULT_SIGNATURE;
+    page.bit.cause = cause;
+    page.bit.isrCountLow = isrCount & 0xFFFF;
+    page.bit.isrCountHigh = isrCount >> 16;
+    page.bit.loopCount = this->loopCount;
+    page.bit.checksum = calculateChecksum(&page);
+
+    // the stalled loop may have been in the middle of a panel or EEPROM
+    // transfer
+    controlPanel->releaseBus();
+    this->eeprom->abort();
+    this->eeprom->writePageNow(EEPROM_FAULT_PAGE, page.all);
+}
+
+void Supervisor :: ISR(void)
+{
+    // once faulted, stop feeding the watchdog and let it reset the CPU
+    if( this->faulted ) {
+        return;
+    }
+
+#ifndef USE_CLA_ENGINE
+    // the stepper interrupt counts itself in CpuTimer0.InterruptCount
+    Uint32 isrCount = CpuTimer0.InterruptCount;
+    if( isrCount == this->previousIsrCount ) {
+        fault(FAULT_ISR_STALL);
+        return;
+    }
+    this->previousIsrCount = isrCount;
+#endif // USE_CLA_ENGINE
+
+    Uint16 loopCount = this->loopCount;
+    if( loopCount == this->previousLoopCount ) {
+        if( ++this->loopIdleTicks >= LOOP_TIMEOUT_TICKS ) {
+            fault(FAULT_LOOP_STALL);
+            return;
+        }
+    }
+    else {
+        this->loopIdleTicks = 0;
+        this->previousLoopCount = loopCount;
+    }
+
+    ServiceDog();
+}
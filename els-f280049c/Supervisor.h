@@ -0,0 +1,116 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __SUPERVISOR_H
+#define __SUPERVISOR_H
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "EEPROM.h"
+#include "ControlPanel.h"
+#include "Core.h"
+
+
+// Identifies a fault record written by this firmware
+#define FAULT_SIGNATURE 0xE15E
+
+// Fault causes
+#define FAULT_NONE 0
+#define FAULT_ISR_STALL 1       // the stepper interrupt stopped
+#define FAULT_LOOP_STALL 2      // the user interface loop stopped
+#define FAULT_WATCHDOG 3        // the watchdog reset the CPU before a record was made
+
+struct FAULT_BITS
+{
+    Uint16 signature;
+    Uint16 cause;
+    Uint16 isrCountLow;
+    Uint16 isrCountHigh;
+    Uint16 loopCount;
+    Uint16 reserved[2];
+    Uint16 checksum;
+};
+
+typedef union FAULT_PAGE
+{
+    Uint16 all[EEPROM_PAGE_SIZE];
+    struct FAULT_BITS bit;
+} FAULT_PAGE;
+
+
+//
+// Stall supervisor
+//
+// A low-rate timer interrupt checks that the stepper interrupt and the user
+// interface loop have both made progress since last time, and only then
+// services the hardware watchdog.  If either has stalled, it turns the drives
+// off at once, writes a fault record to EEPROM and lets the watchdog reset
+// the CPU.  If the supervisor itself can't run, the watchdog resets the CPU
+// anyway, and the next boot reports that instead.
+//
+class Supervisor
+{
+private:
+    EEPROM *eeprom;
+    ControlPanel *controlPanel;
+    Core *core;
+
+    // progress seen at the last check
+    Uint32 previousIsrCount;
+    Uint16 loopCount;
+    Uint16 previousLoopCount;
+
+    // supervisor ticks since the loop last made progress
+    Uint16 loopIdleTicks;
+
+    bool faulted;
+
+    Uint16 calculateChecksum(FAULT_PAGE *page);
+    void fault(Uint16 cause);
+
+public:
+    Supervisor(EEPROM *eeprom, ControlPanel *controlPanel, Core *core);
+
+    // read and clear the fault record from the last run; returns the cause
+    Uint16 checkFault(void);
+
+    // start the supervisor timer and the watchdog
+    void initHardware(void);
+
+    // mark progress from the user interface loop
+    void heartbeat(void);
+
+    // from the supervisor timer interrupt
+    void ISR(void);
+};
+
+inline void Supervisor :: heartbeat(void)
+{
+    this->loopCount++;
+}
+
+
+#endif // __SUPERVISOR_H
@@ -222,24 +222,56 @@ const FEED_THREAD *FeedTable :: current(void)
     return &table[selectedRow];
 }
 
-const FEED_THREAD *FeedTable :: next(void)
+const FEED_THREAD *FeedTable :: next(Uint16 rows)
 {
-    if( this->selectedRow < this->numRows - 1 )
+    if( this->selectedRow + rows < this->numRows )
     {
-        this->selectedRow++;
+        this->selectedRow += rows;
+    }
+    else
+    {
+        this->selectedRow = this->numRows - 1;
     }
     return this->current();
 }
 
-const FEED_THREAD *FeedTable :: previous(void)
+const FEED_THREAD *FeedTable :: previous(Uint16 rows)
 {
-    if( this->selectedRow > 0 )
+    if( this->selectedRow > rows )
+    {
+        this->selectedRow -= rows;
+    }
+    else
     {
-        this->selectedRow--;
+        this->selectedRow = 0;
     }
     return this->current();
 }
 
+Uint16 FeedTable :: getSelection(void)
+{
+    return this->selectedRow;
+}
+
+const FEED_THREAD *FeedTable :: select(Uint16 index)
+{
+    if( index < this->numRows )
+    {
+        this->selectedRow = index;
+    }
+    return this->current();
+}
+
+Uint16 FeedTable :: size(void)
+{
+    return this->numRows;
+}
+
+const FEED_THREAD *FeedTable :: row(Uint16 index)
+{
+    return &table[index];
+}
+
 FeedTableFactory::FeedTableFactory(void):
         inchThreads(inch_thread_table, sizeof(inch_thread_table)/sizeof(inch_thread_table[0]), 12),
         inchFeeds(inch_feed_table, sizeof(inch_feed_table)/sizeof(inch_feed_table[0]), 4),
@@ -54,8 +54,17 @@ public:
     FeedTable(const FEED_THREAD *table, Uint16 numRows, Uint16 defaultSelection);
 
     const FEED_THREAD *current(void);
-    const FEED_THREAD *next(void);
-    const FEED_THREAD *previous(void);
+    // move the selection, by several rows at once if asked; stops at the ends
+    const FEED_THREAD *next(Uint16 rows = 1);
+    const FEED_THREAD *previous(Uint16 rows = 1);
+
+    // the selected row, by index
+    Uint16 getSelection(void);
+    const FEED_THREAD *select(Uint16 index);
+
+    // direct access to rows, without changing the selection
+    Uint16 size(void);
+    const FEED_THREAD *row(Uint16 index);
 };
 
 
@@ -0,0 +1,169 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "ThreadingCycle.h"
+
+
+ThreadingCycle :: ThreadingCycle(Core *core)
+{
+    this->core = core;
+
+    this->state = CYCLE_OFF;
+    this->enabled = false;
+    this->startPosition = 0;
+    this->stopPosition = 0;
+    this->departed = false;
+}
+
+void ThreadingCycle :: confine(void)
+{
+    // keep the carriage between the start and the stop
+    if( towardStop() > 0 ) {
+        core->setLimits(this->startPosition, this->stopPosition);
+    }
+    else {
+        core->setLimits(this->stopPosition, this->startPosition);
+    }
+}
+
+void ThreadingCycle :: arm(void)
+{
+    // wait at the start for the index pulse
+    confine();
+    core->armAtIndex(towardStop());
+
+    this->departed = false;
+    this->state = CYCLE_ARMED;
+}
+
+void ThreadingCycle :: cancel(void)
+{
+    core->stopJog();
+    core->engage();
+
+    // put back the operator's stop, if there still is one
+    if( core->isStopSet() ) {
+        core->setStop(this->stopPosition);
+    }
+
+    this->state = CYCLE_OFF;
+}
+
+void ThreadingCycle :: returnToStart(void)
+{
+    if( ! canReturn() || core->getRPM() != 0 ) {
+        return;
+    }
+
+    confine();
+    core->jogTo(this->startPosition);
+    this->state = CYCLE_JOGGING;
+}
+
+void ThreadingCycle :: ratchetLimits(int32 carriagePosition)
+{
+    // while returning, only let the carriage move back toward the start; if the
+    // spindle goes forward again before it gets there, the steps are dropped
+    if( towardStop() > 0 ) {
+        core->setLimits(this->startPosition, carriagePosition);
+    }
+    else {
+        core->setLimits(carriagePosition, this->startPosition);
+    }
+}
+
+void ThreadingCycle :: loop(void)
+{
+    int32 carriagePosition = core->getCarriagePosition();
+
+    if( this->state != CYCLE_OFF && ! (this->enabled && core->isStopSet()) ) {
+        cancel();
+        return;
+    }
+
+    switch( this->state ) {
+
+    case CYCLE_OFF:
+        // start when the spindle is stopped with the carriage short of the stop
+        if( this->enabled && core->isStopSet() && core->getRPM() == 0 ) {
+            this->stopPosition = core->getStopPosition();
+            if( carriagePosition != this->stopPosition ) {
+                this->startPosition = carriagePosition;
+                arm();
+            }
+        }
+        break;
+
+    case CYCLE_ARMED:
+        if( core->isEngaged() ) {
+            this->state = CYCLE_FEEDING;
+        }
+        break;
+
+    case CYCLE_FEEDING:
+        if( carriagePosition == this->stopPosition ) {
+            this->state = CYCLE_AT_STOP;
+        }
+        else if( carriagePosition != this->startPosition ) {
+            this->departed = true;
+        }
+        else if( this->departed ) {
+            // the spindle was reversed all the way back; steps may have been
+            // dropped at the start, so resync
+            arm();
+        }
+        break;
+
+    case CYCLE_AT_STOP:
+        if( carriagePosition != this->stopPosition ) {
+            ratchetLimits(carriagePosition);
+            this->state = CYCLE_RETURNING;
+        }
+        break;
+
+    case CYCLE_RETURNING:
+        if( carriagePosition == this->startPosition ) {
+            arm();
+        }
+        else {
+            ratchetLimits(carriagePosition);
+        }
+        break;
+
+    case CYCLE_JOGGING:
+        if( ! core->isJogging() ) {
+            if( carriagePosition == this->startPosition ) {
+                arm();
+            }
+            else {
+                // the jog was cut short; carry on as if returning by hand
+                ratchetLimits(carriagePosition);
+                this->state = CYCLE_RETURNING;
+            }
+        }
+        break;
+    }
+}
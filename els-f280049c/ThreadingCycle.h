@@ -0,0 +1,118 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __THREADINGCYCLE_H
+#define __THREADINGCYCLE_H
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "Core.h"
+
+
+typedef enum CYCLE_STATE
+{
+    CYCLE_OFF,          // not running; leadscrew follows the spindle normally
+    CYCLE_ARMED,        // at the start position, waiting for the index pulse
+    CYCLE_FEEDING,      // engaged and cutting toward the stop
+    CYCLE_AT_STOP,      // parked at the stop, waiting for the spindle to reverse
+    CYCLE_RETURNING,    // spindle reversed, carriage running back to the start
+    CYCLE_JOGGING       // spindle stopped, jogging back to the start
+} CYCLE_STATE;
+
+
+//
+// Semi-automatic threading cycle
+//
+// The operator sets a stop at the end of the thread, brings the carriage back
+// to the start and stops the spindle.  The cycle then takes the start position
+// from the carriage and, on every pass, engages at the spindle index pulse,
+// feeds to the stop and parks there.  The operator retracts the cross slide and
+// reverses the spindle to run the carriage back to the start, or stops the
+// spindle and jogs back, and the cycle re-arms for the next pass on the same
+// thread phase.
+//
+// All of the state lives here and is serviced from the user interface loop; the
+// ISR only sees the limits and the engage request through Core.
+//
+class ThreadingCycle
+{
+private:
+    Core *core;
+
+    CYCLE_STATE state;
+
+    // is the cycle allowed to run?  set by the user interface
+    bool enabled;
+
+    // carriage positions of the start of each pass and the stop, in steps
+    int32 startPosition;
+    int32 stopPosition;
+
+    // has the carriage left the start position on this pass?
+    bool departed;
+
+    int16 towardStop(void);
+    void confine(void);
+    void arm(void);
+    void cancel(void);
+    void ratchetLimits(int32 carriagePosition);
+
+public:
+    ThreadingCycle(Core *core);
+
+    void setEnabled(bool enabled);
+    CYCLE_STATE getState(void);
+
+    // jog back to the start after a cut; the spindle must be stopped
+    bool canReturn(void);
+    void returnToStart(void);
+
+    // service the cycle; call at the user interface rate
+    void loop(void);
+};
+
+inline void ThreadingCycle :: setEnabled(bool enabled)
+{
+    this->enabled = enabled;
+}
+
+inline CYCLE_STATE ThreadingCycle :: getState(void)
+{
+    return this->state;
+}
+
+inline bool ThreadingCycle :: canReturn(void)
+{
+    return this->state == CYCLE_AT_STOP || this->state == CYCLE_RETURNING;
+}
+
+inline int16 ThreadingCycle :: towardStop(void)
+{
+    return (this->stopPosition > this->startPosition) ? 1 : -1;
+}
+
+
+#endif // __THREADINGCYCLE_H
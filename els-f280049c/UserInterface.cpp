@@ -26,6 +26,29 @@
 
 #include "UserInterface.h"
 
+
+// How long SET must be held to arm or clear a stop
+#define SET_HOLD_TIME (UI_REFRESH_RATE_HZ * 1)
+
+//
+// CARRIAGE POSITION CONVERSIONS
+//
+// Convert leadscrew steps to tenths of a millimeter or hundredths of an inch
+// for display.  These use the threading drive ratio.
+//
+#if defined(LEADSCREW_TPI)
+#define CARRIAGE_MM_NUMERATOR ((int64)254)
+#define CARRIAGE_MM_DENOMINATOR ((int64)LEADSCREW_TPI*STEPPER_RESOLUTION*STEPPER_MICROSTEPS)
+#define CARRIAGE_IN_NUMERATOR ((int64)100)
+#define CARRIAGE_IN_DENOMINATOR ((int64)LEADSCREW_TPI*STEPPER_RESOLUTION*STEPPER_MICROSTEPS)
+#endif
+#if defined(LEADSCREW_HMM)
+#define CARRIAGE_MM_NUMERATOR ((int64)LEADSCREW_HMM)
+#define CARRIAGE_MM_DENOMINATOR ((int64)STEPPER_RESOLUTION*STEPPER_MICROSTEPS*10)
+#define CARRIAGE_IN_NUMERATOR ((int64)LEADSCREW_HMM*10)
+#define CARRIAGE_IN_DENOMINATOR ((int64)STEPPER_RESOLUTION*STEPPER_MICROSTEPS*254)
+#endif
+
 const MESSAGE STARTUP_MESSAGE_2 =
 {
   .message = { LETTER_E, LETTER_L, LETTER_S, DASH, ONE | POINT, FOUR | POINT, ZERO, ZERO },
@@ -51,6 +74,42 @@ const MESSAGE SETTINGS_MESSAGE_POSITION =
  .displayTime = UI_REFRESH_RATE_HZ * .5
 };
 
+const MESSAGE SETTINGS_MESSAGE_CARRIAGE =
+{
+ .message = { LETTER_C, LETTER_A, LETTER_R, LETTER_R, LETTER_I, LETTER_A, LETTER_G, LETTER_E },
+ .displayTime = UI_REFRESH_RATE_HZ * .5
+};
+
+const MESSAGE SETTINGS_MESSAGE_DIVIDING =
+{
+ .message = { LETTER_D, LETTER_I, LETTER_V, LETTER_I, LETTER_D, LETTER_E, BLANK, BLANK },
+ .displayTime = UI_REFRESH_RATE_HZ * .5
+};
+
+const MESSAGE SETTINGS_MESSAGE_BACKLASH =
+{
+ .message = { LETTER_B, LETTER_A, LETTER_C, LETTER_K, LETTER_L, LETTER_A, LETTER_S, LETTER_H },
+ .displayTime = UI_REFRESH_RATE_HZ * .5
+};
+
+const MESSAGE STOP_SET_MESSAGE =
+{
+ .message = { LETTER_S, LETTER_T, LETTER_O, LETTER_P, BLANK, LETTER_S, LETTER_E, LETTER_T },
+ .displayTime = UI_REFRESH_RATE_HZ * 1
+};
+
+const MESSAGE STOP_CLEAR_MESSAGE =
+{
+ .message = { LETTER_S, LETTER_T, LETTER_O, LETTER_P, BLANK, LETTER_C, LETTER_L, LETTER_R },
+ .displayTime = UI_REFRESH_RATE_HZ * 1
+};
+
+const MESSAGE RETURN_MESSAGE =
+{
+ .message = { LETTER_R, LETTER_E, LETTER_T, LETTER_U, LETTER_R, LETTER_N, BLANK, BLANK },
+ .displayTime = UI_REFRESH_RATE_HZ * .5
+};
+
 extern const MESSAGE BACKLOG_PANIC_MESSAGE_2;
 const MESSAGE BACKLOG_PANIC_MESSAGE_1 =
 {
@@ -65,6 +124,67 @@ const MESSAGE BACKLOG_PANIC_MESSAGE_2 =
  .next = &BACKLOG_PANIC_MESSAGE_1
 };
 
+extern const MESSAGE SERVO_ALARM_MESSAGE_2;
+const MESSAGE SERVO_ALARM_MESSAGE_1 =
+{
+ .message = { LETTER_S, LETTER_E, LETTER_R, LETTER_V, LETTER_O, BLANK, LETTER_A, LETTER_L },
+ .displayTime = UI_REFRESH_RATE_HZ * .5,
+ .next = &SERVO_ALARM_MESSAGE_2
+};
+const MESSAGE SERVO_ALARM_MESSAGE_2 =
+{
+ .message = { LETTER_P, LETTER_O, LETTER_W, LETTER_E, LETTER_R, BLANK, LETTER_R, LETTER_S },
+ .displayTime = UI_REFRESH_RATE_HZ * .5,
+ .next = &SERVO_ALARM_MESSAGE_1
+};
+
+const MESSAGE RESYNC_MESSAGE =
+{
+ .message = { LETTER_R, LETTER_E, LETTER_S, LETTER_Y, LETTER_N, LETTER_C, BLANK, BLANK },
+ .displayTime = UI_REFRESH_RATE_HZ * 1
+};
+
+
+// filled in with E index.phase.direction error counts when reported
+MESSAGE ENCODER_COUNTS_MESSAGE =
+{
+ .message = { LETTER_E, BLANK, ZERO, ZERO | POINT, ZERO, ZERO | POINT, ZERO, ZERO },
+ .displayTime = UI_REFRESH_RATE_HZ * 2
+};
+
+const MESSAGE ENCODER_ERROR_MESSAGE =
+{
+ .message = { LETTER_E, LETTER_N, LETTER_C, BLANK, LETTER_E, LETTER_R, LETTER_R, BLANK },
+ .displayTime = UI_REFRESH_RATE_HZ * 1,
+ .next = &ENCODER_COUNTS_MESSAGE
+};
+
+// filled in with the number of divisions when it is changed
+MESSAGE DIVISIONS_MESSAGE =
+{
+ .message = { LETTER_D, LETTER_I, LETTER_V, BLANK, BLANK, BLANK, BLANK, BLANK },
+ .displayTime = UI_REFRESH_RATE_HZ * 1
+};
+
+const Uint16 MESSAGE_DIGITS[10] = { ZERO, ONE, TWO, THREE, FOUR, FIVE, SIX, SEVEN, EIGHT, NINE };
+
+const MESSAGE ISR_STALL_MESSAGE =
+{
+ .message = { LETTER_I, LETTER_S, LETTER_R, BLANK, LETTER_H, LETTER_U, LETTER_N, LETTER_G },
+ .displayTime = UI_REFRESH_RATE_HZ * 3
+};
+
+const MESSAGE LOOP_STALL_MESSAGE =
+{
+ .message = { BLANK, LETTER_U, LETTER_I, BLANK, LETTER_H, LETTER_U, LETTER_N, LETTER_G },
+ .displayTime = UI_REFRESH_RATE_HZ * 3
+};
+
+const MESSAGE WATCHDOG_MESSAGE =
+{
+ .message = { LETTER_W, LETTER_D, LETTER_O, LETTER_G, BLANK, LETTER_R, LETTER_S, LETTER_T },
+ .displayTime = UI_REFRESH_RATE_HZ * 3
+};
 
 
 const Uint16 VALUE_BLANK[4] = { BLANK, BLANK, BLANK, BLANK };
@@ -74,19 +194,38 @@ UserInterface :: UserInterface(ControlPanel *controlPanel, Core *core, FeedTable
     this->controlPanel = controlPanel;
     this->core = core;
     this->feedTableFactory = feedTableFactory;
+    this->threadingCycle = NULL;
+    this->encoderMonitor = NULL;
+    this->powerMonitor = NULL;
+    this->blackBox = NULL;
+    this->dividingHead = NULL;
+    this->settings = NULL;
 
     this->metric = true; // start out with metric
     this->thread = false; // start out with feeds
     this->reverse = false; // start out going forward
-    this->sposition = false; // start out showing RPM
+    this->displayMode = DISPLAY_RPM; // start out showing RPM
+    this->setHoldTime = 0;
 
     this->feedTable = NULL;
 
     this->keys.all = 0xff;
+    this->released.all = 0;
+    this->upRows = 0;
+    this->downRows = 0;
+
+    this->encoderErrorCount = 0;
+
+    this->reviewing = false;
+    this->reviewAge = 0;
+    this->reviewSamples = false;
+    this->reviewSample = 0;
+
+    this->backlashChanged = false;
 
     // initialize the core so we start up correctly
     core->setReverse(this->reverse);
-    core->setFeed(loadFeedTable());
+    setFeed(loadFeedTable());
 
     setMessage(&STARTUP_MESSAGE_1);
 }
@@ -97,6 +236,16 @@ const FEED_THREAD *UserInterface::loadFeedTable()
     return this->feedTable->current();
 }
 
+void UserInterface :: setFeed(const FEED_THREAD *feed)
+{
+    core->setFeed(feed);
+
+    // the black box records which row of the table is in use
+    if( this->blackBox != NULL ) {
+        this->blackBox->setFeedRow(this->feedTable->getSelection());
+    }
+}
+
 LED_REG UserInterface::calculateLEDs()
 {
     // get the LEDs for this feed
@@ -149,9 +298,351 @@ void UserInterface :: clearMessage( void )
     controlPanel->setMessage(NULL);
 }
 
+KEY_REG UserInterface :: readKeyPresses( void )
+{
+    KEY_REG pressed;
+    KEY_EVENT event;
+
+    pressed.all = 0;
+    this->released.all = 0;
+    this->upRows = 0;
+    this->downRows = 0;
+
+    // presses and repeats both act; a held UP or DOWN adds up its rows
+    while( controlPanel->getKeyEvent(&event) ) {
+        if( event.type != KEY_RELEASED ) {
+            pressed.all |= event.key.all;
+            if( event.key.bit.UP ) this->upRows += event.count;
+            if( event.key.bit.DOWN ) this->downRows += event.count;
+        }
+        else {
+            this->released.all |= event.key.all;
+        }
+    }
+    return pressed;
+}
+
+void UserInterface :: cycleDisplayMode( void )
+{
+    // a new backlash is written to EEPROM once, when its display is left
+    if( this->displayMode == DISPLAY_BACKLASH && this->backlashChanged ) {
+        this->settings->save();
+        this->backlashChanged = false;
+    }
+
+    switch( this->displayMode )
+    {
+    case DISPLAY_RPM:
+        this->displayMode = DISPLAY_SPOSITION;
+        setMessage(&SETTINGS_MESSAGE_POSITION);
+        break;
+    case DISPLAY_SPOSITION:
+        this->displayMode = DISPLAY_CARRIAGE;
+        setMessage(&SETTINGS_MESSAGE_CARRIAGE);
+        break;
+    case DISPLAY_CARRIAGE:
+        if( this->dividingHead != NULL ) {
+            this->displayMode = DISPLAY_DIVIDING;
+            setMessage(&SETTINGS_MESSAGE_DIVIDING);
+            break;
+        }
+        // fall through
+    case DISPLAY_DIVIDING:
+        if( this->settings != NULL ) {
+            this->displayMode = DISPLAY_BACKLASH;
+            setMessage(&SETTINGS_MESSAGE_BACKLASH);
+            break;
+        }
+        // fall through
+    default:
+        this->displayMode = DISPLAY_RPM;
+        setMessage(&SETTINGS_MESSAGE_RPM);
+        break;
+    }
+}
+
+void UserInterface :: toggleStop( void )
+{
+    if( core->isStopSet() )
+    {
+        core->clearStop();
+        setMessage(&STOP_CLEAR_MESSAGE);
+    }
+    else
+    {
+        core->setStop(core->getCarriagePosition());
+        setMessage(&STOP_SET_MESSAGE);
+    }
+
+    // show where the carriage is relative to the stop
+    this->displayMode = DISPLAY_CARRIAGE;
+}
+
+int32 UserInterface :: carriageDisplayValue( void )
+{
+    int64 steps = core->getCarriagePosition();
+
+    if( this->metric )
+    {
+        return steps * CARRIAGE_MM_NUMERATOR / CARRIAGE_MM_DENOMINATOR;
+    }
+    return steps * CARRIAGE_IN_NUMERATOR / CARRIAGE_IN_DENOMINATOR;
+}
+
+void UserInterface :: setThreadingCycle(ThreadingCycle *threadingCycle)
+{
+    this->threadingCycle = threadingCycle;
+}
+
+void UserInterface :: setEncoderMonitor(EncoderMonitor *encoderMonitor)
+{
+    this->encoderMonitor = encoderMonitor;
+}
+
+void UserInterface :: setPowerMonitor(PowerMonitor *powerMonitor)
+{
+    this->powerMonitor = powerMonitor;
+}
+
+void UserInterface :: setBlackBox(BlackBox *blackBox)
+{
+    this->blackBox = blackBox;
+    this->blackBox->setFeedRow(this->feedTable->getSelection());
+}
+
+void UserInterface :: setDividingHead(DividingHead *dividingHead)
+{
+    this->dividingHead = dividingHead;
+}
+
+void UserInterface :: setSettings(Settings *settings)
+{
+    this->settings = settings;
+}
+
+void UserInterface :: restoreState(Uint16 flags, Uint16 feedIndex)
+{
+    this->metric = (flags & SNAPSHOT_METRIC) != 0;
+    this->thread = (flags & SNAPSHOT_THREAD) != 0;
+    this->reverse = (flags & SNAPSHOT_REVERSE) != 0;
+
+    core->setReverse(this->reverse);
+    loadFeedTable();
+    setFeed(this->feedTable->select(feedIndex));
+    core->setPowerOn((flags & SNAPSHOT_POWER_ON) != 0);
+}
+
+void UserInterface :: checkEncoder( void )
+{
+    Uint16 errorCount = this->encoderMonitor->getErrorCount();
+
+    if( errorCount != this->encoderErrorCount ) {
+        Uint16 counts[3] = {
+            this->encoderMonitor->getIndexErrors(),
+            this->encoderMonitor->getPhaseErrors(),
+            this->encoderMonitor->getDirectionErrors()
+        };
+        Uint16 *text = ENCODER_COUNTS_MESSAGE.message;
+
+        for( Uint16 i=0; i < 3; i++ ) {
+            Uint16 count = (counts[i] > 99) ? 99 : counts[i];
+            text[2 + i*2] = MESSAGE_DIGITS[count / 10];
+            text[3 + i*2] = MESSAGE_DIGITS[count % 10] | ((i < 2) ? POINT : 0);
+        }
+
+        // let a report already on the display run, and never cover a panic
+        if( this->message != &ENCODER_ERROR_MESSAGE &&
+            this->message != &ENCODER_COUNTS_MESSAGE &&
+            this->message != &BACKLOG_PANIC_MESSAGE_1 &&
+            this->message != &BACKLOG_PANIC_MESSAGE_2 &&
+            this->message != &SERVO_ALARM_MESSAGE_1 &&
+            this->message != &SERVO_ALARM_MESSAGE_2 ) {
+            setMessage(&ENCODER_ERROR_MESSAGE);
+        }
+
+        this->encoderErrorCount = errorCount;
+    }
+}
+
+void UserInterface :: changeDivisions( void )
+{
+    Uint16 divisions = this->dividingHead->getDivisions();
+
+    divisions += this->upRows;
+    divisions = (divisions > this->downRows) ? divisions - this->downRows : 0;
+    this->dividingHead->setDivisions(divisions);
+
+    // DIV and the count, with leading blanks
+    divisions = this->dividingHead->getDivisions();
+    Uint16 *text = DIVISIONS_MESSAGE.message;
+    for( Uint16 i=7; i > 3; i-- ) {
+        text[i] = (divisions == 0 && i < 7) ? BLANK : MESSAGE_DIGITS[divisions % 10];
+        divisions /= 10;
+    }
+    setMessage(&DIVISIONS_MESSAGE);
+}
+
+void UserInterface :: changeBacklash( void )
+{
+    Uint16 steps = this->settings->getBacklashSteps();
+
+    steps += this->upRows;
+    steps = (steps > this->downRows) ? steps - this->downRows : 0;
+    this->settings->setBacklashSteps(steps);
+
+    // takes effect at the next reversal
+    core->setBacklash(this->settings->getBacklashSteps());
+    this->backlashChanged = true;
+}
+
 void UserInterface :: panicStepBacklog( void )
 {
     setMessage(&BACKLOG_PANIC_MESSAGE_1);
+
+    if( this->blackBox != NULL ) {
+        this->blackBox->freeze(BLACKBOX_STEP_BACKLOG);
+    }
+}
+
+void UserInterface :: checkAlarm( void )
+{
+    if( this->message != &SERVO_ALARM_MESSAGE_1 && this->message != &SERVO_ALARM_MESSAGE_2 ) {
+        setMessage(&SERVO_ALARM_MESSAGE_1);
+    }
+}
+
+void UserInterface :: resetAlarm( void )
+{
+    // nothing happens until the drive itself has been reset
+    if( core->clearAlarm() ) {
+        setMessage(&RESYNC_MESSAGE);
+    }
+}
+
+void UserInterface :: startReview( void )
+{
+    clearMessage();
+    this->reviewing = true;
+    this->reviewAge = 0;
+    this->reviewSamples = false;
+    showFault();
+}
+
+void UserInterface :: reviewFaults( void )
+{
+    if( keys.bit.SET || keys.bit.POWER ) {
+        this->reviewing = false;
+        controlPanel->setMessage(NULL);
+        return;
+    }
+
+    // FWD/REV opens the samples of the record shown, if there is one, and
+    // goes back to the record
+    if( keys.bit.FWD_REV ) {
+        if( this->reviewSamples ) {
+            this->reviewSamples = false;
+            showFault();
+        }
+        else if( this->blackBox->readRecord(this->reviewAge) ) {
+            this->reviewSamples = true;
+            this->reviewSample = 0;
+            showSample();
+        }
+        return;
+    }
+
+    // UP goes back in time, DOWN forward
+    if( this->reviewSamples ) {
+        if( keys.bit.UP && this->reviewSample + 1 < BLACKBOX_SLOT_SAMPLES ) {
+            this->reviewSample++;
+            showSample();
+        }
+        if( keys.bit.DOWN && this->reviewSample > 0 ) {
+            this->reviewSample--;
+            showSample();
+        }
+        return;
+    }
+    if( keys.bit.UP && this->reviewAge + 1 < BLACKBOX_SLOTS ) {
+        this->reviewAge++;
+        showFault();
+    }
+    if( keys.bit.DOWN && this->reviewAge > 0 ) {
+        this->reviewAge--;
+        showFault();
+    }
+}
+
+void UserInterface :: showFault( void )
+{
+    static const Uint16 CAUSES[3][5] = {
+        { LETTER_N, LETTER_O, LETTER_N, LETTER_E, BLANK },      // BLACKBOX_NONE
+        { LETTER_F, LETTER_A, LETTER_S, LETTER_T, BLANK },      // BLACKBOX_STEP_BACKLOG
+        { LETTER_A, LETTER_L, LETTER_A, LETTER_R, LETTER_M }    // BLACKBOX_SERVO_ALARM
+    };
+    Uint16 cause = this->blackBox->getCause(this->reviewAge);
+
+    if( cause > BLACKBOX_SERVO_ALARM ) {
+        cause = BLACKBOX_NONE;
+    }
+
+    // F, the record number counting from 1, then the cause
+    this->reviewText[0] = LETTER_F;
+    this->reviewText[1] = MESSAGE_DIGITS[this->reviewAge + 1];
+    this->reviewText[2] = BLANK;
+    for( Uint16 i=0; i < 5; i++ ) {
+        this->reviewText[3 + i] = CAUSES[cause][i];
+    }
+    controlPanel->setMessage(this->reviewText);
+}
+
+void UserInterface :: showSample( void )
+{
+    int32 backlog = this->blackBox->getRecordBacklog(this->reviewSample);
+    Uint16 age = (this->reviewSample > 99) ? 99 : this->reviewSample;
+
+    // the sample number counting back from the fault, then B and the
+    // backlog, desired less current steps, with leading blanks
+    this->reviewText[0] = MESSAGE_DIGITS[age / 10];
+    this->reviewText[1] = MESSAGE_DIGITS[age % 10];
+    this->reviewText[2] = BLANK;
+    this->reviewText[3] = LETTER_B;
+
+    bool negative = backlog < 0;
+    Uint32 value = negative ? -backlog : backlog;
+    if( value > (negative ? 999 : 9999) ) {
+        value = negative ? 999 : 9999;
+    }
+    for( Uint16 i=7; i > 3; i-- ) {
+        if( value != 0 || i == 7 ) {
+            this->reviewText[i] = MESSAGE_DIGITS[value % 10];
+        }
+        else if( negative ) {
+            this->reviewText[i] = DASH;
+            negative = false;
+        }
+        else {
+            this->reviewText[i] = BLANK;
+        }
+        value /= 10;
+    }
+    controlPanel->setMessage(this->reviewText);
+}
+
+void UserInterface :: reportFault( Uint16 cause )
+{
+    switch( cause )
+    {
+    case FAULT_ISR_STALL:
+        setMessage(&ISR_STALL_MESSAGE);
+        break;
+    case FAULT_LOOP_STALL:
+        setMessage(&LOOP_STALL_MESSAGE);
+        break;
+    case FAULT_WATCHDOG:
+        setMessage(&WATCHDOG_MESSAGE);
+        break;
+    }
 }
 
 void UserInterface :: loop( void )
@@ -160,32 +651,66 @@ void UserInterface :: loop( void )
     Uint16 currentRpm = core->getRPM();
 
     // read the current spindle position to keep this up to date
-    Uint16 currentSPosition = encoder->getSPosition();
+    Uint16 currentSPosition = core->getSPosition();
+
+    // report any new encoder errors
+    if( this->encoderMonitor != NULL ) {
+        checkEncoder();
+    }
+
+    // hold a servo alarm on the display until it is reset
+    if( core->isAlarmLatched() ) {
+        checkAlarm();
+    }
 
     // display an override message, if there is one
     overrideMessage();
 
-    // read keypresses from the control panel
-    keys = controlPanel->getKeys();
+    // collect the keys pressed since the last pass
+    keys = readKeyPresses();
+
+    // the black box takes over the panel until SET is pressed again
+    if( this->reviewing ) {
+        reviewFaults();
+        controlPanel->refresh(this->displayMode);
+        return;
+    }
 
     // respond to keypresses
-    // respond regardless of machine state
-    if( keys.bit.SET ) {
-        this->sposition =! this->sposition;
-        if ( sposition ) {
-            setMessage(&SETTINGS_MESSAGE_POSITION);
-        } else {
-            setMessage(&SETTINGS_MESSAGE_RPM);
+    // respond regardless of machine state; SET acts when it is let go, and
+    // only if it was not held long enough to do something else
+    if( released.bit.SET && this->setHoldTime < SET_HOLD_TIME ) {
+        cycleDisplayMode();
+    }
+
+    // holding SET arms or clears a stop at the current carriage position, or
+    // with the power off, opens the black box
+    if( controlPanel->getHeldKeys().bit.SET ) {
+        if( ++this->setHoldTime == SET_HOLD_TIME ) {
+            if( this->core->isPowerOn() ) {
+                toggleStop();
+            }
+            else if( this->blackBox != NULL && currentRpm == 0 ) {
+                startReview();
+            }
         }
     }
+    else {
+        this->setHoldTime = 0;
+    }
 
 
     if( currentRpm == 0 )
     {
         // these keys should only be sensitive when the machine is stopped
         if( keys.bit.POWER ) {
-            this->core->setPowerOn(!this->core->isPowerOn());
-            clearMessage();
+            if( this->core->isAlarmLatched() ) {
+                resetAlarm();
+            }
+            else {
+                this->core->setPowerOn(!this->core->isPowerOn());
+                clearMessage();
+            }
         }
 
         // these should only work when the power is on
@@ -193,21 +718,52 @@ void UserInterface :: loop( void )
             if( keys.bit.IN_MM )
             {
                 this->metric = ! this->metric;
-                core->setFeed(loadFeedTable());
+                setFeed(loadFeedTable());
             }
             if( keys.bit.FEED_THREAD )
             {
                 this->thread = ! this->thread;
-                core->setFeed(loadFeedTable());
+                setFeed(loadFeedTable());
             }
             if( keys.bit.FWD_REV )
             {
-                this->reverse = ! this->reverse;
-                core->setReverse(this->reverse);
+                // after a threading pass, this key jogs back to the start
+                if( this->threadingCycle != NULL && this->threadingCycle->canReturn() ) {
+                    this->threadingCycle->returnToStart();
+                    setMessage(&RETURN_MESSAGE);
+                }
+                else {
+                    this->reverse = ! this->reverse;
+                    core->setReverse(this->reverse);
+                }
             }
         }
     }
 
+    // the threading cycle only runs in thread mode
+    if( this->threadingCycle != NULL ) {
+        this->threadingCycle->setEnabled(this->thread && this->core->isPowerOn());
+    }
+
+    // the dividing head takes UP and DOWN for the number of divisions, at
+    // any time, and leaves the feed alone
+    if( this->displayMode == DISPLAY_DIVIDING ) {
+        if( keys.bit.UP || keys.bit.DOWN ) {
+            changeDivisions();
+        }
+        keys.bit.UP = 0;
+        keys.bit.DOWN = 0;
+    }
+
+    // and so does the backlash setting, for the steps to take up
+    if( this->displayMode == DISPLAY_BACKLASH ) {
+        if( keys.bit.UP || keys.bit.DOWN ) {
+            changeBacklash();
+        }
+        keys.bit.UP = 0;
+        keys.bit.DOWN = 0;
+    }
+
 #ifdef IGNORE_ALL_KEYS_WHEN_RUNNING
     if( currentRpm == 0 )
         {
@@ -218,11 +774,11 @@ void UserInterface :: loop( void )
             // these keys can be operated when the machine is running
             if( keys.bit.UP )
             {
-                core->setFeed(feedTable->next());
+                setFeed(feedTable->next(this->upRows));
             }
             if( keys.bit.DOWN )
             {
-                core->setFeed(feedTable->previous());
+                setFeed(feedTable->previous(this->downRows));
             }
         }
 
@@ -234,10 +790,25 @@ void UserInterface :: loop( void )
     controlPanel->setLEDs(calculateLEDs());
     controlPanel->setValue(feedTable->current()->display);
 
-    if ( sposition ) {
+    switch( this->displayMode ) {
+    case DISPLAY_SPOSITION:
         controlPanel->setSPosition(currentSPosition);
-    } else {
+        break;
+    case DISPLAY_CARRIAGE:
+        controlPanel->setCarriagePosition(carriageDisplayValue(), this->metric ? 1 : 2);
+        break;
+    case DISPLAY_DIVIDING:
+        this->dividingHead->update();
+        controlPanel->setDivision(
+                this->dividingHead->isReferenced() ? this->dividingHead->getDivision() + 1 : 0,
+                this->dividingHead->getError());
+        break;
+    case DISPLAY_BACKLASH:
+        controlPanel->setBacklash(this->settings->getBacklashSteps());
+        break;
+    default:
         controlPanel->setRPM(currentRpm);
+        break;
     }
 
     if( ! core->isPowerOn() )
@@ -245,5 +816,15 @@ void UserInterface :: loop( void )
         controlPanel->setValue(VALUE_BLANK);
     }
 
-    controlPanel->refresh(sposition);
+    controlPanel->refresh(this->displayMode);
+
+    // keep the brownout snapshot current
+    if( this->powerMonitor != NULL ) {
+        this->powerMonitor->setState(
+                (this->metric ? SNAPSHOT_METRIC : 0) |
+                (this->thread ? SNAPSHOT_THREAD : 0) |
+                (this->reverse ? SNAPSHOT_REVERSE : 0) |
+                (this->core->isPowerOn() ? SNAPSHOT_POWER_ON : 0),
+                this->feedTable->getSelection());
+    }
 }
@@ -30,6 +30,13 @@
 #include "ControlPanel.h"
 #include "Core.h"
 #include "Tables.h"
+#include "ThreadingCycle.h"
+#include "EncoderMonitor.h"
+#include "PowerMonitor.h"
+#include "Supervisor.h"
+#include "BlackBox.h"
+#include "DividingHead.h"
+#include "Settings.h"
 
 typedef struct MESSAGE
 {
@@ -43,33 +50,89 @@ class UserInterface
 private:
     ControlPanel *controlPanel;
     Core *core;
-    Encoder *encoder;
     FeedTableFactory *feedTableFactory;
+    ThreadingCycle *threadingCycle;
+    EncoderMonitor *encoderMonitor;
+    PowerMonitor *powerMonitor;
+    BlackBox *blackBox;
+    DividingHead *dividingHead;
+    Settings *settings;
 
     bool metric;
     bool thread;
     bool reverse;
-    bool sposition;
+    DISPLAY_MODE displayMode;
+
+    // number of loops the SET key has been held down
+    Uint16 setHoldTime;
 
     FeedTable *feedTable;
 
     KEY_REG keys;
 
+    // keys let go since the last pass
+    KEY_REG released;
+
+    // rows to move for UP and DOWN this pass, counting repeats
+    Uint16 upRows;
+    Uint16 downRows;
+
     const MESSAGE *message;
     Uint16 messageTime;
 
+    // encoder errors already reported
+    Uint16 encoderErrorCount;
+
+    // browsing the black box, the record shown (0 is the newest), whether its
+    // samples are shown and which (0 is the newest), and the text
+    bool reviewing;
+    Uint16 reviewAge;
+    bool reviewSamples;
+    Uint16 reviewSample;
+    Uint16 reviewText[8];
+
+    // the backlash has been changed from the panel and not yet saved
+    bool backlashChanged;
+
     const FEED_THREAD *loadFeedTable();
+    void setFeed(const FEED_THREAD *feed);
     LED_REG calculateLEDs();
     void setMessage(const MESSAGE *message);
     void overrideMessage( void );
     void clearMessage( void );
+    KEY_REG readKeyPresses( void );
+    void cycleDisplayMode( void );
+    void toggleStop( void );
+    int32 carriageDisplayValue( void );
+    void checkEncoder( void );
+    void checkAlarm( void );
+    void resetAlarm( void );
+    void startReview( void );
+    void reviewFaults( void );
+    void showFault( void );
+    void showSample( void );
+    void changeDivisions( void );
+    void changeBacklash( void );
 
 public:
     UserInterface(ControlPanel *controlPanel, Core *core, FeedTableFactory *feedTableFactory);
 
+    void setThreadingCycle(ThreadingCycle *threadingCycle);
+    void setEncoderMonitor(EncoderMonitor *encoderMonitor);
+    void setPowerMonitor(PowerMonitor *powerMonitor);
+    void setBlackBox(BlackBox *blackBox);
+    void setDividingHead(DividingHead *dividingHead);
+    void setSettings(Settings *settings);
+
+    // pick up where a brownout left off, from PowerMonitor SNAPSHOT_* flags
+    void restoreState(Uint16 flags, Uint16 feedIndex);
+
     void loop( void );
 
     void panicStepBacklog( void );
+
+    // show why the last run ended, from Supervisor FAULT_* causes
+    void reportFault( Uint16 cause );
 };
 
 #endif // __USERINTERFACE_H
@@ -29,15 +29,40 @@
 #include "SanityCheck.h"
 #include "ControlPanel.h"
 #include "EEPROM.h"
+#include "Settings.h"
 #include "StepperDrive.h"
 #include "Encoder.h"
 
 #include "Core.h"
 #include "UserInterface.h"
 #include "Debug.h"
+#include "ThreadingCycle.h"
+#include "ClaEngine.h"
+#include "SlaveAxis.h"
+#include "PitchCompensation.h"
+#include "EncoderMonitor.h"
+#include "Handwheel.h"
+#include "PowerMonitor.h"
+#include "Supervisor.h"
+#include "BlackBox.h"
+#include "DividingHead.h"
+#include "RateGovernor.h"
+
+
+// the stepper ISR and the state it touches run from zero-wait RAM; see the
+// hotfuncs and hotdata sections in the linker command files
+#pragma CODE_SECTION("hotfuncs")
+__interrupt void cpu_timer0_isr(void);
 
+__interrupt void epwm8_isr(void);
 
-__interrupt void cpu_timer0_isr(void);
+#ifdef USE_BROWNOUT_SNAPSHOT
+__interrupt void adcb_evt_isr(void);
+#endif // USE_BROWNOUT_SNAPSHOT
+
+#ifdef USE_SUPERVISOR
+__interrupt void cpu_timer1_isr(void);
+#endif // USE_SUPERVISOR
 
 
 //
@@ -47,6 +72,7 @@ __interrupt void cpu_timer0_isr(void);
 //
 
 // Debug harness
+#pragma DATA_SECTION("hotdata")
 Debug debug;
 
 // Feed table factory
@@ -61,18 +87,87 @@ ControlPanel controlPanel(&spiBus);
 // EEPROM driver
 EEPROM eeprom(&spiBus);
 
+// Persistent machine settings
+Settings settings(&eeprom);
+
+#ifdef USE_PITCH_COMPENSATION
+// Leadscrew pitch error map
+#pragma DATA_SECTION("hotdata")
+PitchCompensation pitchCompensation(&eeprom);
+#endif // USE_PITCH_COMPENSATION
+
 // Encoder driver
-Encoder encoder;
+#pragma DATA_SECTION("hotdata")
+Encoder encoder(&ENCODER_REGS);
+
+#ifdef USE_MPG
+// Handwheel on the other eQEP
+#pragma DATA_SECTION("hotdata")
+Encoder handwheelEncoder(&MPG_REGS);
+#pragma DATA_SECTION("hotdata")
+Handwheel handwheel(&handwheelEncoder);
+#endif // USE_MPG
+
+#ifdef USE_ENCODER_MONITOR
+// Encoder signal monitor
+EncoderMonitor encoderMonitor(&encoder);
+#endif // USE_ENCODER_MONITOR
+
+#ifdef USE_IDLE_RATE
+// Stepper interrupt rate governor
+#pragma DATA_SECTION("hotdata")
+RateGovernor rateGovernor;
+#endif // USE_IDLE_RATE
+
+#ifdef USE_DIVIDING_HEAD
+// Dividing head readout
+DividingHead dividingHead(&encoder);
+#endif // USE_DIVIDING_HEAD
 
 // Stepper driver
-StepperDrive stepperDrive;
+const STEPPER_PINS leadscrewPins = Z_STEPPER_PINS;
+#pragma DATA_SECTION("hotdata")
+StepperDrive stepperDrive(&leadscrewPins);
+
+#ifdef USE_X_AXIS
+// Cross slide stepper driver, slaved to the spindle
+const STEPPER_PINS crossSlidePins = X_STEPPER_PINS;
+#pragma DATA_SECTION("hotdata")
+StepperDrive crossSlideDrive(&crossSlidePins);
+#pragma DATA_SECTION("hotdata")
+SlaveAxis crossSlide(&crossSlideDrive, X_SCALE_NUMERATOR, X_SCALE_DENOMINATOR);
+#endif // USE_X_AXIS
 
 // Core engine
+#pragma DATA_SECTION("hotdata")
 Core core(&encoder, &stepperDrive);
 
+#ifdef USE_CLA_ENGINE
+ClaEngine claEngine(&stepperDrive);
+#endif // USE_CLA_ENGINE
+
 // User interface
 UserInterface userInterface(&controlPanel, &core, &feedTableFactory);
 
+#ifdef USE_BROWNOUT_SNAPSHOT
+// Brownout detection and state snapshot
+PowerMonitor powerMonitor(&eeprom, &controlPanel, &core);
+#endif // USE_BROWNOUT_SNAPSHOT
+
+#ifdef USE_SUPERVISOR
+// Stall supervisor and watchdog
+Supervisor supervisor(&eeprom, &controlPanel, &core);
+#endif // USE_SUPERVISOR
+
+#ifdef USE_BLACKBOX
+// Fault black box; the history is too big for hotdata
+BlackBox blackBox(&eeprom, &encoder, &stepperDrive, &core);
+#endif // USE_BLACKBOX
+
+#ifdef USE_THREADING_CYCLE
+ThreadingCycle threadingCycle(&core);
+#endif // USE_THREADING_CYCLE
+
 void main(void)
 {
 #ifdef _FLASH
@@ -107,6 +202,13 @@ void main(void)
     // Set up the CPU0 timer ISR
     EALLOW;
     PieVectTable.TIMER0_INT = &cpu_timer0_isr;
+    PieVectTable.EPWM8_INT = &epwm8_isr;
+#ifdef USE_BROWNOUT_SNAPSHOT
+    PieVectTable.ADCB_EVT_INT = &adcb_evt_isr;
+#endif // USE_BROWNOUT_SNAPSHOT
+#ifdef USE_SUPERVISOR
+    PieVectTable.TIMER1_INT = &cpu_timer1_isr;
+#endif // USE_SUPERVISOR
     EDIS;
 
     // initialize the CPU timer
@@ -124,11 +226,97 @@ void main(void)
     stepperDrive.initHardware();
     encoder.initHardware();
 
+#ifdef USE_MPG
+    handwheel.initHardware();
+    core.setHandwheel(&handwheel);
+#endif // USE_MPG
+
+#ifdef USE_X_AXIS
+    crossSlideDrive.initHardware();
+    core.addSlaveAxis(&crossSlide);
+#if X_TAPER_NUMERATOR == 0
+    // power facing: the cross slide takes the feed and the carriage holds
+    core.disengage();
+#endif
+#endif // USE_X_AXIS
+
+#ifdef USE_CLA_ENGINE
+    // start the stepper engine on the CLA, and hand it the feed
+    claEngine.initHardware();
+    core.setClaEngine(&claEngine);
+#endif // USE_CLA_ENGINE
+
+    // load the per-machine settings and apply them
+    settings.load();
+    stepperDrive.setBacklash(settings.getBacklashSteps());
+    userInterface.setSettings(&settings);
+
+#ifdef USE_BROWNOUT_SNAPSHOT
+    // pick up where the last brownout left off
+    if( powerMonitor.restore() ) {
+        core.setCarriagePosition(powerMonitor.getCarriagePosition());
+        if( powerMonitor.getFlags() & SNAPSHOT_STOP_SET ) {
+            core.setStop(powerMonitor.getStopPosition());
+        }
+        userInterface.restoreState(powerMonitor.getFlags(), powerMonitor.getFeedIndex());
+    }
+    powerMonitor.initHardware();
+    userInterface.setPowerMonitor(&powerMonitor);
+#endif // USE_BROWNOUT_SNAPSHOT
+
+#ifdef USE_SUPERVISOR
+    // report why the last run ended, if it was a fault
+    userInterface.reportFault(supervisor.checkFault());
+#endif // USE_SUPERVISOR
+
+#ifdef USE_PITCH_COMPENSATION
+    pitchCompensation.load();
+    core.setPitchCompensation(&pitchCompensation);
+#endif // USE_PITCH_COMPENSATION
+
+#ifdef USE_BLACKBOX
+    blackBox.load();
+    userInterface.setBlackBox(&blackBox);
+#endif // USE_BLACKBOX
+
+#ifdef USE_THREADING_CYCLE
+    userInterface.setThreadingCycle(&threadingCycle);
+#endif // USE_THREADING_CYCLE
+
+#ifdef USE_ENCODER_MONITOR
+    encoderMonitor.initHardware();
+    userInterface.setEncoderMonitor(&encoderMonitor);
+#endif // USE_ENCODER_MONITOR
+
+#ifdef USE_DIVIDING_HEAD
+    dividingHead.initHardware();
+    userInterface.setDividingHead(&dividingHead);
+#endif // USE_DIVIDING_HEAD
+
+#ifndef USE_CLA_ENGINE
     // Enable CPU INT1 which is connected to CPU-Timer 0
     IER |= M_INT1;
 
     // Enable TINT0 in the PIE: Group 1 interrupt 7
     PieCtrlRegs.PIEIER1.bit.INTx7 = 1;
+#endif // USE_CLA_ENGINE
+
+    // Enable CPU INT3 and EPWM8_INT in the PIE, for the key scan: Group 3
+    // interrupt 8
+    IER |= M_INT3;
+    PieCtrlRegs.PIEIER3.bit.INTx8 = 1;
+
+#ifdef USE_BROWNOUT_SNAPSHOT
+    // Enable CPU INT10 and ADCB_EVT in the PIE: Group 10 interrupt 5
+    IER |= M_INT10;
+    PieCtrlRegs.PIEIER10.bit.INTx5 = 1;
+#endif // USE_BROWNOUT_SNAPSHOT
+
+#ifdef USE_SUPERVISOR
+    // Start the supervisor on CPU-Timer 1 (CPU INT13), and the watchdog
+    supervisor.initHardware();
+    IER |= M_INT13;
+#endif // USE_SUPERVISOR
 
     // Enable global Interrupts and higher priority real-time debug events
     EINT;
@@ -140,13 +328,52 @@ void main(void)
         debug.begin2();
 
         // check for step backlog and panic the system if it occurs
+#ifdef USE_CLA_ENGINE
+        if( claEngine.checkStepBacklog() ) {
+#else
         if( stepperDrive.checkStepBacklog() ) {
+#endif // USE_CLA_ENGINE
+            userInterface.panicStepBacklog();
+        }
+#ifdef USE_X_AXIS
+        if( crossSlideDrive.checkStepBacklog() ) {
             userInterface.panicStepBacklog();
         }
+#endif // USE_X_AXIS
+
+#ifdef USE_ENCODER_MONITOR
+        // check the encoder signal
+        encoderMonitor.loop();
+#endif // USE_ENCODER_MONITOR
+
+#ifdef USE_BROWNOUT_SNAPSHOT
+        // arm the brownout trip once the supply is up
+        powerMonitor.loop();
+#endif // USE_BROWNOUT_SNAPSHOT
+
+#ifdef USE_BLACKBOX
+        // save the history of any new fault
+        blackBox.loop();
+#endif // USE_BLACKBOX
+
+#ifdef USE_MPG
+        // read the handwheel scale selector
+        handwheel.loop();
+#endif // USE_MPG
 
         // service the user interface
         userInterface.loop();
 
+#ifdef USE_THREADING_CYCLE
+        // service the threading cycle
+        threadingCycle.loop();
+#endif // USE_THREADING_CYCLE
+
+#ifdef USE_SUPERVISOR
+        // tell the supervisor the loop is still running
+        supervisor.heartbeat();
+#endif // USE_SUPERVISOR
+
         // mark end of loop for debugging
         debug.end2();
 
@@ -168,6 +395,16 @@ cpu_timer0_isr(void)
     // service the Core engine ISR, which in turn services the StepperDrive ISR
     core.ISR();
 
+#ifdef USE_BLACKBOX
+    // record the history for the fault black box
+    blackBox.ISR();
+#endif // USE_BLACKBOX
+
+#ifdef USE_IDLE_RATE
+    // slow the interrupt down while there is nothing for it to do
+    rateGovernor.ISR(core.isIdle());
+#endif // USE_IDLE_RATE
+
     // flag exit from ISR for timing
     debug.end1();
 
@@ -177,4 +414,41 @@ cpu_timer0_isr(void)
     PieCtrlRegs.PIEACK.all = PIEACK_GROUP1;
 }
 
+// ePWM8 ISR: scan the control panel keys
+__interrupt void
+epwm8_isr(void)
+{
+    // acknowledge up front, then let the stepper interrupt, the brownout
+    // detector and the supervisor preempt the scan, which spends most of its
+    // time waiting on the slow SPI bus; whichever of them are in use were
+    // enabled on entry
+    EPwm8Regs.ETCLR.bit.INT = 1;
+    PieCtrlRegs.PIEACK.all = PIEACK_GROUP3;
+    IER &= M_INT1 | M_INT10 | M_INT13;
+    asm(" NOP");
+    EINT;
+
+    controlPanel.scanKeys();
+
+    // IER is restored on return
+    DINT;
+}
+
+#ifdef USE_BROWNOUT_SNAPSHOT
+// ADCB event ISR: the supply has dropped below the brownout threshold
+__interrupt void
+adcb_evt_isr(void)
+{
+    // save the state and wait for the power to go; does not return
+    powerMonitor.brownout();
+}
+#endif // USE_BROWNOUT_SNAPSHOT
 
+#ifdef USE_SUPERVISOR
+// CPU Timer 1 ISR: check for stalls and feed the watchdog
+__interrupt void
+cpu_timer1_isr(void)
+{
+    supervisor.ISR();
+}
+#endif // USE_SUPERVISOR
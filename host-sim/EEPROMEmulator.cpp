@@ -0,0 +1,221 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "EEPROMEmulator.h"
+#include "HostClock.h"
+
+
+// instructions common to both chips
+#define EEPROM_READ 0x03
+#define EEPROM_WRITE 0x02
+#define EEPROM_WRDI 0x04
+#define EEPROM_RDSR 0x05
+#define EEPROM_WREN 0x06
+
+// nothing to do for the rest of the transaction
+#define EEPROM_IGNORE 0xFF
+
+// status register
+#define STATUS_WIP 0x01
+#define STATUS_WEL 0x02
+
+// longest write cycle, in nanoseconds
+#define WRITE_CYCLE_NS 5000000ULL
+
+
+EEPROMEmulator :: EEPROMEmulator(void)
+{
+    for( int i=0; i < EEPROM_EMULATOR_BYTES; i++ ) {
+        this->memory[i] = 0xFF;
+    }
+    this->selected = false;
+    this->command = EEPROM_IGNORE;
+    this->count = 0;
+    this->address = 0;
+    this->written = false;
+    this->writeEnabled = false;
+    this->busyUntil = 0;
+    this->writes = 0;
+    this->errors = 0;
+}
+
+void EEPROMEmulator :: updateSelect(void)
+{
+    bool released = GpioDataRegs.GPBSET.bit.GPIO34;
+    bool asserted = GpioDataRegs.GPBCLEAR.bit.GPIO34;
+
+    GpioDataRegs.GPBSET.bit.GPIO34 = 0;
+    GpioDataRegs.GPBCLEAR.bit.GPIO34 = 0;
+
+    // the firmware ends each transaction before it starts the next, so a
+    // release and an assert seen together came in that order
+    if( released && this->selected ) {
+        endTransaction();
+    }
+    if( asserted ) {
+        this->selected = true;
+        this->command = EEPROM_IGNORE;
+        this->count = 0;
+        this->written = false;
+    }
+}
+
+void EEPROMEmulator :: endTransaction(void)
+{
+    // a page write starts its write cycle when the chip is deselected
+    if( this->command == EEPROM_WRITE && this->written ) {
+        this->busyUntil = hostClockNow() + WRITE_CYCLE_NS;
+        this->writeEnabled = false;
+        this->writes++;
+    }
+    this->selected = false;
+}
+
+bool EEPROMEmulator :: isBusy(void)
+{
+    return hostClockNow() < this->busyUntil;
+}
+
+bool EEPROMEmulator :: shift(Uint16 out, Uint16 bits, bool talk, Uint16 *in)
+{
+    updateSelect();
+
+    if( ! this->selected ) {
+        return false;
+    }
+
+    // most significant byte first
+    if( bits == 16 ) {
+        Uint16 high = shiftByte(out >> 8, talk);
+        *in = (high << 8) | shiftByte(out & 0xFF, talk);
+    }
+    else {
+        *in = shiftByte(out, talk);
+    }
+    return true;
+}
+
+Uint16 EEPROMEmulator :: shiftByte(Uint16 out, bool talk)
+{
+    Uint16 index = this->count++;
+
+    if( index == 0 ) {
+        Uint16 instruction = out;
+
+        if( ! talk ) {
+            this->errors++;
+            instruction = EEPROM_IGNORE;
+        }
+#ifdef EEPROM_CHIP_25AA040A
+        // the 25AA040A takes address bit 8 in bit 3 of the instruction
+        else if( (out & 0xF7) == EEPROM_READ || (out & 0xF7) == EEPROM_WRITE ) {
+            instruction = out & 0xF7;
+            this->address = (out & 0x08) << 5;
+        }
+#endif
+
+        // only the status can be read during a write cycle
+        if( instruction != EEPROM_RDSR && instruction != EEPROM_IGNORE && isBusy() ) {
+            this->errors++;
+            instruction = EEPROM_IGNORE;
+        }
+
+        switch( instruction )
+        {
+        case EEPROM_WREN:
+            this->writeEnabled = true;
+            break;
+        case EEPROM_WRDI:
+            this->writeEnabled = false;
+            break;
+        case EEPROM_WRITE:
+            if( ! this->writeEnabled ) {
+                this->errors++;
+                instruction = EEPROM_IGNORE;
+            }
+            break;
+        case EEPROM_READ:
+        case EEPROM_RDSR:
+        case EEPROM_IGNORE:
+            break;
+        default:
+            this->errors++;
+            instruction = EEPROM_IGNORE;
+            break;
+        }
+        this->command = instruction;
+        return 0xFF;
+    }
+
+    switch( this->command )
+    {
+    case EEPROM_RDSR:
+        return (this->writeEnabled ? STATUS_WEL : 0) | (isBusy() ? STATUS_WIP : 0);
+
+    case EEPROM_READ:
+    case EEPROM_WRITE:
+        if( index <= EEPROM_EMULATOR_ADDRESS_BYTES ) {
+#if EEPROM_EMULATOR_ADDRESS_BYTES == 1
+            this->address = (this->address & 0x100) | out;
+#else
+            this->address = ((this->address << 8) | out) & (EEPROM_EMULATOR_BYTES - 1);
+#endif
+            return 0xFF;
+        }
+
+        if( this->command == EEPROM_READ ) {
+            Uint16 data = this->memory[this->address];
+            this->address = (this->address + 1) & (EEPROM_EMULATOR_BYTES - 1);
+            return data;
+        }
+
+        // writes wrap around within the page
+        this->memory[this->address] = out & 0xFF;
+        this->address = (this->address & ~(EEPROM_EMULATOR_PAGE_BYTES - 1)) |
+                ((this->address + 1) & (EEPROM_EMULATOR_PAGE_BYTES - 1));
+        this->written = true;
+        return 0xFF;
+    }
+
+    return 0xFF;
+}
+
+Uint16 EEPROMEmulator :: getWord(Uint16 page, Uint16 word)
+{
+    Uint16 address = (page * EEPROM_PAGE_SIZE + word) * 2;
+
+    return (this->memory[address] << 8) | this->memory[address + 1];
+}
+
+Uint32 EEPROMEmulator :: getWrites(void)
+{
+    return this->writes;
+}
+
+Uint32 EEPROMEmulator :: getErrors(void)
+{
+    return this->errors;
+}
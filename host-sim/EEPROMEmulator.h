@@ -0,0 +1,93 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __EEPROM_EMULATOR_H
+#define __EEPROM_EMULATOR_H
+
+//
+// The SPI EEPROM for the configured HARDWARE_VERSION, on the host SPI bus
+// with GPIO34 as its chip select.  Starts out blank, takes the usual 5ms
+// write cycle on the host clock, and counts commands it has to ignore.
+//
+
+#include "F28x_Project.h"
+#include "EEPROM.h"
+#include "HostSPIBus.h"
+
+
+#ifdef EEPROM_CHIP_25AA040A
+#define EEPROM_EMULATOR_BYTES 512
+#define EEPROM_EMULATOR_PAGE_BYTES 16
+#define EEPROM_EMULATOR_ADDRESS_BYTES 1
+#endif
+#ifdef EEPROM_CHIP_AT25080B
+#define EEPROM_EMULATOR_BYTES 1024
+#define EEPROM_EMULATOR_PAGE_BYTES 32
+#define EEPROM_EMULATOR_ADDRESS_BYTES 2
+#endif
+
+
+class EEPROMEmulator : public HostSPIDevice
+{
+private:
+    Uint16 memory[EEPROM_EMULATOR_BYTES];
+
+    // chip select, and the command and byte count of this transaction
+    bool selected;
+    Uint16 command;
+    Uint16 count;
+    Uint16 address;
+    bool written;
+
+    // write enable latch, and when the write cycle under way ends
+    bool writeEnabled;
+    Uint64 busyUntil;
+
+    Uint32 writes;
+    Uint32 errors;
+
+    void updateSelect(void);
+    void endTransaction(void);
+    bool isBusy(void);
+    Uint16 shiftByte(Uint16 out, bool talk);
+
+public:
+    EEPROMEmulator(void);
+
+    // HostSPIDevice
+    virtual bool shift(Uint16 out, Uint16 bits, bool talk, Uint16 *in);
+
+    // a word as the firmware reads it, from a page of EEPROM_PAGE_SIZE words
+    Uint16 getWord(Uint16 page, Uint16 word);
+
+    // write cycles, and commands ignored because the chip was busy, not
+    // write enabled, or not sent as a command
+    Uint32 getWrites(void);
+    Uint32 getErrors(void);
+};
+
+
+#endif // __EEPROM_EMULATOR_H
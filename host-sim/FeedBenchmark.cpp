@@ -0,0 +1,271 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//
+// Feed and thread table benchmark
+//
+// Turns a simulated spindle encoder through whole revolutions for every row of
+// every feed and thread table, in both directions and across the encoder
+// wrap, runs the real Core and StepperDrive ISRs against it and compares the
+// steps emitted with the exact ratio.  Reports the worst error at any point,
+// the error at the end of the run and the time spent in the ISRs per spindle
+// tick, and fails if any row is ever more than one step off.
+//
+// usage: feed-benchmark [revolutions]
+//
+
+#include <stdio.h>
+#include <chrono>
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "Tables.h"
+#include "Core.h"
+#include "Encoder.h"
+#include "StepperDrive.h"
+
+
+// Spindle revolutions per row and direction, unless given on the command line
+#define DEFAULT_REVOLUTIONS 20
+
+// Spindle counts advanced per tick.  This is enough to move the spindle past
+// the standstill deadband every tick, so the filtered position follows the
+// simulated encoder exactly.
+#if SPINDLE_DEADBAND_COUNTS >= 3
+#define COUNTS_PER_TICK (SPINDLE_DEADBAND_COUNTS + 1)
+#else
+#define COUNTS_PER_TICK 3
+#endif
+
+// Maximum allowed difference between emitted and exact steps
+#define TOLERANCE_STEPS 1
+
+// Most ISR cycles the drive may take to catch up after a tick, before the row
+// is abandoned as broken
+#define MAX_ISR_PER_TICK 1000
+
+// The benchmark drive has no pins, so its outputs go nowhere
+const STEPPER_PINS BENCHMARK_PINS = { 0, 0, 0, 0, 0 };
+
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct RESULT
+{
+    int32 worstError;           // steps, at any tick
+    int32 cumulativeError;      // steps, at the end of the run
+    Uint64 ticks;
+    Uint64 isrCalls;
+    Clock::duration isrTime;    // total, and the longest tick
+    Clock::duration maxTickTime;
+} RESULT;
+
+
+class FeedBenchmark
+{
+private:
+    // the encoder reads a simulated eQEP in RAM
+    volatile struct EQEP_REGS encoderRegs;
+    Encoder encoder;
+    StepperDrive drive;
+    Core core;
+
+    Uint32 revolutions;
+
+    Clock::duration runTick(RESULT *result);
+
+public:
+    FeedBenchmark(Uint32 revolutions);
+
+    void runRow(const FEED_THREAD *row, int16 spindleDirection, RESULT *result);
+};
+
+
+FeedBenchmark :: FeedBenchmark(Uint32 revolutions) :
+        encoder(&encoderRegs),
+        drive(&BENCHMARK_PINS),
+        core(&encoder, &drive)
+{
+    this->revolutions = revolutions;
+    this->encoderRegs.QPOSCNT = 0;
+    this->core.setReverse(false);
+}
+
+Clock::duration FeedBenchmark :: runTick(RESULT *result)
+{
+    // run the real engine until the drive has caught up
+    Clock::time_point start = Clock::now();
+    Uint16 cycles = 0;
+    do {
+        core.ISR();
+        result->isrCalls++;
+    } while( ! drive.isIdle() && ++cycles < MAX_ISR_PER_TICK );
+
+    return Clock::now() - start;
+}
+
+void FeedBenchmark :: runRow(const FEED_THREAD *row, int16 spindleDirection, RESULT *result)
+{
+    const Uint32 modulus = _ENCODER_MAX_COUNT;  // QPOSCNT runs from 0 to QPOSMAX
+    const Uint32 span = revolutions * ENCODER_RESOLUTION;
+
+    // start half a run away from the wrap point, so every run crosses it
+    Uint32 spindlePosition = (spindleDirection > 0) ? modulus - span/2 : span/2;
+
+    // settle the engine at the start with the drive disabled, so it syncs to
+    // the spindle without stepping; approach the start in the run direction,
+    // so the deadband filter is already following the spindle
+    core.setFeed(row);
+    drive.setEnabled(false);
+    this->encoderRegs.QPOSCNT = (spindleDirection > 0) ?
+            spindlePosition - COUNTS_PER_TICK :
+            spindlePosition + COUNTS_PER_TICK;
+    core.ISR();
+    this->encoderRegs.QPOSCNT = spindlePosition;
+    core.ISR();
+    drive.setEnabled(true);
+
+    // exact position, as whole steps plus a remainder in 1/denominator steps,
+    // tracked incrementally so it never overflows
+    int64 exactSteps = (int64)(spindlePosition * row->numerator / row->denominator);
+    Uint64 exactRemainder = spindlePosition * row->numerator % row->denominator;
+    Uint64 tickNumerator = COUNTS_PER_TICK * row->numerator;
+    Uint64 tickSteps = tickNumerator / row->denominator;
+    Uint64 tickRemainder = tickNumerator % row->denominator;
+
+    // steps are counted where the drive emits them, in the carriage position
+    int64 startSteps = exactSteps;
+    int32 startCarriage = drive.getCarriagePosition();
+
+    memset(result, 0, sizeof(*result));
+
+    for( Uint32 travelled = 0; travelled < span; travelled += COUNTS_PER_TICK ) {
+        // advance the simulated spindle, wrapping the way the eQEP does
+        if( spindleDirection > 0 ) {
+            spindlePosition += COUNTS_PER_TICK;
+            if( spindlePosition >= modulus ) spindlePosition -= modulus;
+
+            exactSteps += tickSteps;
+            exactRemainder += tickRemainder;
+            if( exactRemainder >= row->denominator ) {
+                exactRemainder -= row->denominator;
+                exactSteps++;
+            }
+        }
+        else {
+            spindlePosition = (spindlePosition < COUNTS_PER_TICK) ?
+                    spindlePosition + modulus - COUNTS_PER_TICK :
+                    spindlePosition - COUNTS_PER_TICK;
+
+            exactSteps -= tickSteps;
+            if( exactRemainder < tickRemainder ) {
+                exactRemainder += row->denominator;
+                exactSteps--;
+            }
+            exactRemainder -= tickRemainder;
+        }
+        this->encoderRegs.QPOSCNT = spindlePosition;
+
+        Clock::duration tickTime = runTick(result);
+        result->ticks++;
+        result->isrTime += tickTime;
+        if( tickTime > result->maxTickTime ) {
+            result->maxTickTime = tickTime;
+        }
+
+        int32 error = (int32)(drive.getCarriagePosition() - startCarriage - (exactSteps - startSteps));
+        if( abs(error) > abs(result->worstError) ) {
+            result->worstError = error;
+        }
+    }
+
+    result->cumulativeError = (int32)(drive.getCarriagePosition() - startCarriage - (exactSteps - startSteps));
+}
+
+
+static long long nanoseconds(Clock::duration duration)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+int main(int argc, char **argv)
+{
+    static const char *tableNames[2][2] = {
+        { "inch feed", "inch thread" },
+        { "metric feed", "metric thread" }
+    };
+
+    Uint32 revolutions = (argc > 1) ? strtoul(argv[1], NULL, 10) : DEFAULT_REVOLUTIONS;
+    if( revolutions < 1 || revolutions > 1000 ) {
+        fprintf(stderr, "revolutions must be between 1 and 1000\n");
+        return 2;
+    }
+
+    FeedTableFactory feedTableFactory;
+    FeedBenchmark benchmark(revolutions);
+    Uint16 rowsFailed = 0;
+
+#ifdef USE_FLOATING_POINT
+    printf("floating point build, ");
+#else
+    printf("integer build, ");
+#endif
+    printf("%lu revolutions of %lu counts per row and direction\n\n",
+            (unsigned long)revolutions, (unsigned long)ENCODER_RESOLUTION);
+    printf("%-14s %4s %4s %20s %20s %6s %6s %9s %9s\n",
+            "table", "row", "dir", "numerator", "denominator", "worst", "end", "ns/tick", "max ns");
+
+    for( int metric = 0; metric < 2; metric++ ) {
+        for( int thread = 0; thread < 2; thread++ ) {
+            FeedTable *table = feedTableFactory.getFeedTable(metric, thread);
+
+            for( Uint16 i = 0; i < table->size(); i++ ) {
+                const FEED_THREAD *row = table->row(i);
+
+                // run the spindle both ways, so both encoder wrap directions are crossed
+                for( int16 direction = 1; direction >= -1; direction -= 2 ) {
+                    RESULT result;
+                    benchmark.runRow(row, direction, &result);
+
+                    bool pass = abs(result.worstError) <= TOLERANCE_STEPS;
+                    printf("%-14s %4u %4s %20llu %20llu %6ld %6ld %9lld %9lld%s\n",
+                            tableNames[metric][thread], (unsigned)i, (direction > 0) ? "fwd" : "rev",
+                            (unsigned long long)row->numerator, (unsigned long long)row->denominator,
+                            (long)result.worstError, (long)result.cumulativeError,
+                            nanoseconds(result.isrTime) / (long long)result.ticks,
+                            nanoseconds(result.maxTickTime),
+                            pass ? "" : "  FAIL");
+                    if( ! pass ) {
+                        rowsFailed++;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("\n%u runs out of tolerance\n", (unsigned)rowsFailed);
+    return (rowsFailed == 0) ? 0 : 1;
+}
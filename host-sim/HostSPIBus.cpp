@@ -0,0 +1,190 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//
+// SPIBus for the host build: the register accesses of SPIBus.cpp, with the
+// SPIB shift register modelled in waitForSerial(), taking as long on the
+// host clock as it would on the target
+//
+
+#include "SPIBus.h"
+#include "HostSPIBus.h"
+#include "HostClock.h"
+#include "F28x_Project.h"
+
+// wait for the current serial shift operation to complete
+#define WAIT_FOR_SERIAL waitForSerial()
+
+// a 16-bit word takes about 160us to shift; give up after a few times that
+#define SPI_TIMEOUT_LOOPS 20000
+
+// most devices that can share the bus
+#define MAX_DEVICES 4
+
+
+static HostSPIDevice *devices[MAX_DEVICES];
+static Uint16 deviceCount = 0;
+
+void hostSpiAttach(HostSPIDevice *device)
+{
+    if( device == NULL ) {
+        deviceCount = 0;
+    }
+    else if( deviceCount < MAX_DEVICES ) {
+        devices[deviceCount++] = device;
+    }
+}
+
+// Shift the character in SPITXBUF out through the devices, and what comes
+// back into SPIRXBUF, as the peripheral does once it is out of reset
+static void shiftCharacter(void)
+{
+    if( SpibRegs.SPICCR.bit.SPISWRESET == 0 ) {
+        return;
+    }
+
+    Uint16 bits = SpibRegs.SPICCR.bit.SPICHAR + 1;
+    Uint16 mask = (Uint16)((1UL << bits) - 1);
+    bool talk = SpibRegs.SPICTL.bit.TALK;
+
+    // transmit data is left-justified
+    Uint16 out = (SpibRegs.SPITXBUF >> (16 - bits)) & mask;
+
+    // in three-wire mode the master hears itself while it talks; an idle
+    // line reads high
+    Uint16 in = (talk && SpibRegs.SPIPRI.bit.TRIWIRE) ? out : mask;
+
+    for( Uint16 i=0; i < deviceCount; i++ ) {
+        Uint16 driven;
+        if( devices[i]->shift(out, bits, talk, &driven) ) {
+            in = driven & mask;
+        }
+    }
+
+    // receive data is right-justified
+    SpibRegs.SPIRXBUF = in;
+    SpibRegs.SPISTS.bit.INT_FLAG = 1;
+
+    // LSPCLK is SYSCLK/(2*LSPCLKDIV), and the bit rate LSPCLK/(SPI_BIT_RATE+1)
+    Uint16 divider = ClkCfgRegs.LOSPCP.bit.LSPCLKDIV;
+    Uint16 rate = SpibRegs.SPIBRR.bit.SPI_BIT_RATE;
+    Uint64 sysclks = (Uint64)bits * ((rate < 3) ? 4 : rate + 1) * ((divider == 0) ? 1 : 2 * divider);
+    hostClockAdvance((Uint64)(sysclks * CPU_RATE));
+}
+
+// reading the receive buffer clears the flag
+static Uint16 readReceiveBuffer(void)
+{
+    SpibRegs.SPISTS.bit.INT_FLAG = 0;
+    return SpibRegs.SPIRXBUF;
+}
+
+
+SPIBus :: SPIBus( void )
+{
+    mask = 0xffff;
+    timedOut = false;
+    lockCount = 0;
+}
+
+void SPIBus :: initHardware(void)
+{
+    // Set up slow speed clock
+    ClkCfgRegs.LOSPCP.bit.LSPCLKDIV = 0b100; // LPSCLK = SYSCLK/8 = 12.5MHz
+
+    // Set up SPI B
+    SpibRegs.SPICCR.bit.SPISWRESET = 0; // Enter RESET state
+    setEightBits();
+    SpibRegs.SPICCR.bit.CLKPOLARITY = 1; // data latched on rising edge
+    SpibRegs.SPICTL.bit.CLK_PHASE = 0; // normal clocking scheme
+    SpibRegs.SPICTL.bit.MASTER_SLAVE = 1; // master
+    SpibRegs.SPIBRR.bit.SPI_BIT_RATE = 127; // SPI bit rate = LPSCLK/128 ~ 98Kbps
+    setThreeWire();
+    SpibRegs.SPICCR.bit.SPISWRESET = 1; // clear reset state; ready to transmit
+}
+
+void SPIBus :: setThreeWire( void )
+{
+    SpibRegs.SPIPRI.bit.TRIWIRE = 1; // 3-wire mode
+}
+
+void SPIBus :: setFourWire( void )
+{
+    SpibRegs.SPIPRI.bit.TRIWIRE = 0; // Normal (4-wire) mode
+}
+
+void SPIBus :: setEightBits( void )
+{
+    SpibRegs.SPICCR.bit.SPICHAR = 0x7; // 8 bits
+    mask = 0x00ff;                     // set the mask to 8 bits
+}
+
+void SPIBus :: setSixteenBits( void )
+{
+    SpibRegs.SPICCR.bit.SPICHAR = 0xF; // 16 bits
+    mask = 0xffff;                     // set the mask to 16 bits
+}
+
+void SPIBus :: sendWord(Uint16 data)
+{
+    SpibRegs.SPICTL.bit.TALK = 1;
+    SpibRegs.SPITXBUF = data;
+    WAIT_FOR_SERIAL;
+    dummy = readReceiveBuffer();
+}
+
+void SPIBus :: waitForSerial(void)
+{
+    shiftCharacter();
+
+    for( Uint16 i=0; i < SPI_TIMEOUT_LOOPS; i++ ) {
+        if( SpibRegs.SPISTS.bit.INT_FLAG == 1 ) {
+            return;
+        }
+    }
+    timedOut = true;
+}
+
+bool SPIBus :: checkTimeout(void)
+{
+    bool result = timedOut;
+    timedOut = false;
+    return result;
+}
+
+void SPIBus :: reset(void)
+{
+    SpibRegs.SPICCR.bit.SPISWRESET = 0; // clears the flags, keeps the configuration
+    SpibRegs.SPISTS.bit.INT_FLAG = 0;
+    SpibRegs.SPICCR.bit.SPISWRESET = 1;
+}
+
+Uint16 SPIBus :: receiveWord(void) {
+    SpibRegs.SPICTL.bit.TALK = 0;
+    SpibRegs.SPITXBUF = dummy;
+    WAIT_FOR_SERIAL;
+    return readReceiveBuffer() & mask; // mask off if we're in 8-bit mode
+}
@@ -0,0 +1,55 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __HOST_SPI_BUS_H
+#define __HOST_SPI_BUS_H
+
+//
+// The SPIB peripheral, for the host build.  HostSPIBus.cpp stands in for
+// SPIBus.cpp: it makes the same register accesses, and shifts each character
+// written to SPITXBUF through the devices attached here, leaving what they
+// drive back in SPIRXBUF.
+//
+
+#include "F28x_Project.h"
+
+
+// A device on the bus.  Each one watches its own chip select.
+class HostSPIDevice
+{
+public:
+    // Clock one character of <bits> bits through the device, most significant
+    // bit first, as the SPI shifts it.  <talk> is set if the master drives the
+    // data line.  Returns true and sets <in> if the device drove the line.
+    virtual bool shift(Uint16 out, Uint16 bits, bool talk, Uint16 *in) = 0;
+};
+
+
+// attach a device to the bus, or detach them all with NULL
+void hostSpiAttach(HostSPIDevice *device);
+
+
+#endif // __HOST_SPI_BUS_H
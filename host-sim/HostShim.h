@@ -0,0 +1,66 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __HOSTSHIM_H
+#define __HOSTSHIM_H
+
+//
+// Forced into every firmware source in the host build, ahead of the TI
+// headers, so the firmware compiles unchanged with the workstation compiler.
+//
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// build the C28x side of the TI headers
+#define __TMS320C28XX__
+
+// TI's integer widths, not the host's: int is 16 bits and long is 32 on the
+// C28x, and the firmware relies on wrapping at those widths
+#define DSP28_DATA_TYPES
+#define F28_DATA_TYPES
+typedef int16_t int16;
+typedef int32_t int32;
+typedef int64_t int64;
+typedef uint16_t Uint16;
+typedef uint32_t Uint32;
+typedef uint64_t Uint64;
+typedef float float32;
+typedef long double float64;
+
+// compiler keywords and intrinsics with no host meaning
+#define __interrupt
+#define interrupt
+#define __cregister
+#define cregister
+#define __eallow()
+#define __edis()
+#define __asm(x)
+#define asm(x)
+
+
+#endif // __HOSTSHIM_H
@@ -0,0 +1,52 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//
+// Stand-ins for the parts of the TI driver library the firmware links
+// against, which only touch hardware, and the simulated clock
+//
+
+#include "F28x_Project.h"
+#include "HostClock.h"
+
+
+static Uint64 hostClock = 0;
+
+Uint64 hostClockNow(void)
+{
+    return hostClock;
+}
+
+void hostClockAdvance(Uint64 nanoseconds)
+{
+    hostClock += nanoseconds;
+}
+
+// DELAY_US() spins five cycles a loop, after nine to set up
+extern "C" void F28x_usDelay(long loopCount)
+{
+    hostClockAdvance((Uint64)((loopCount * 5 + 9) * CPU_RATE));
+}
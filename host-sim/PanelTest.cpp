@@ -0,0 +1,277 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//
+// Control panel test
+//
+// Runs the real ControlPanel against the TM1638 emulator on the host SPI bus:
+// checks what the display and LEDs show after each kind of refresh, the bytes
+// each refresh and key scan costs, and the key events that held, released and
+// invalid key states produce.
+//
+
+#include <stdio.h>
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "ControlPanel.h"
+#include "SPIBus.h"
+#include "TM1638Emulator.h"
+
+
+// bytes in a display refresh: brightness, data command, then the address and
+// sixteen bytes of display RAM
+#define REFRESH_BYTES (1 + 1 + 1 + 16)
+
+// bytes in a key scan: data command, then the read command and four scan bytes
+#define SCAN_BYTES (1 + 1 + 4)
+
+// key scans to settle a key, both ways
+#define DEBOUNCE_SCANS (KEY_DEBOUNCE_MS * KEY_SCAN_RATE_HZ / 1000)
+
+// the KEY_REG bits
+#define KEY_UP (1<<0)
+#define KEY_DOWN (1<<2)
+#define KEY_FEED_THREAD (1<<4)
+#define KEY_SET (1<<6)
+
+static const Uint16 VALUE[4] = { ZERO | POINT, ZERO, ONE, TWO };
+static const Uint16 MESSAGE[8] = { LETTER_B, LETTER_A, LETTER_C, LETTER_K, LETTER_L, LETTER_A, LETTER_S, LETTER_H };
+
+
+class PanelTest
+{
+private:
+    SPIBus spiBus;
+    ControlPanel controlPanel;
+    TM1638Emulator panel;
+
+    Uint16 failures;
+
+    void check(const char *name, bool pass);
+    void checkRefresh(const char *name, DISPLAY_MODE mode, const char *text);
+    Uint16 scan(Uint16 count);
+    Uint16 countEvents(KEY_EVENT_TYPE type, Uint16 key, KEY_EVENT *last);
+
+public:
+    PanelTest(void);
+
+    void testDisplay(void);
+    void testBrightness(void);
+    void testKeys(void);
+
+    Uint16 getFailures(void);
+};
+
+
+PanelTest :: PanelTest(void) :
+        controlPanel(&spiBus)
+{
+    this->failures = 0;
+
+    hostSpiAttach(NULL);
+    hostSpiAttach(&panel);
+    spiBus.initHardware();
+    controlPanel.initHardware();
+}
+
+void PanelTest :: check(const char *name, bool pass)
+{
+    printf("%-50s %s\n", name, pass ? "pass" : "FAIL");
+    if( ! pass ) {
+        this->failures++;
+    }
+}
+
+void PanelTest :: checkRefresh(const char *name, DISPLAY_MODE mode, const char *text)
+{
+    char shown[TM1638_TEXT_SIZE];
+
+    panel.clearCounts();
+    controlPanel.refresh(mode);
+    panel.getText(shown);
+
+    bool pass = panel.shows(text) && panel.getBytes() == REFRESH_BYTES &&
+            panel.getErrors() == 0 && ! panel.isSelected() && ! spiBus.isLocked();
+    printf("%-50s %s  [%s] %lu bytes\n", name, pass ? "pass" : "FAIL",
+            shown, (unsigned long)panel.getBytes());
+    if( ! pass ) {
+        this->failures++;
+    }
+}
+
+// run the key scan <count> times; returns the bytes it sent and received
+Uint16 PanelTest :: scan(Uint16 count)
+{
+    panel.clearCounts();
+    for( Uint16 i=0; i < count; i++ ) {
+        controlPanel.scanKeys();
+    }
+    return panel.getErrors() == 0 ? panel.getBytes() : 0;
+}
+
+// drain the key queue, counting events of one type for one key
+Uint16 PanelTest :: countEvents(KEY_EVENT_TYPE type, Uint16 key, KEY_EVENT *last)
+{
+    Uint16 count = 0;
+    KEY_EVENT event;
+
+    while( controlPanel.getKeyEvent(&event) ) {
+        if( event.type == type && event.key.all == key ) {
+            count++;
+            *last = event;
+        }
+        else {
+            // anything else is unexpected
+            count += 100;
+        }
+    }
+    return count;
+}
+
+void PanelTest :: testDisplay(void)
+{
+    LED_REG leds;
+    leds.all = LED_INCH | LED_FEED | LED_FORWARD | LED_POWER;
+    controlPanel.setLEDs(leds);
+    controlPanel.setValue(VALUE);
+
+    controlPanel.setRPM(1200);
+    checkRefresh("RPM", DISPLAY_RPM, "12000.012");
+    check("LEDs", panel.getLEDs() == leds.all);
+
+    controlPanel.setRPM(7);
+    checkRefresh("RPM, leading zeros blanked", DISPLAY_RPM, "   70.012");
+
+    controlPanel.setRPM(12345);
+    checkRefresh("RPM, out of range", DISPLAY_RPM, "99990.012");
+
+    controlPanel.setSPosition(1234);
+    checkRefresh("spindle position", DISPLAY_SPOSITION, "123.40.012");
+
+    controlPanel.setCarriagePosition(-123, 2);
+    checkRefresh("carriage position", DISPLAY_CARRIAGE, "-1.230.012");
+
+    controlPanel.setCarriagePosition(-1234, 2);
+    checkRefresh("carriage position, out of range", DISPLAY_CARRIAGE, "----0.012");
+
+    controlPanel.setDivision(0, 0);
+    checkRefresh("dividing head, not referenced", DISPLAY_DIVIDING, "--------");
+
+    controlPanel.setDivision(17, -25);
+    checkRefresh("dividing head", DISPLAY_DIVIDING, "  17 -2.5");
+
+    controlPanel.setBacklash(250);
+    checkRefresh("backlash", DISPLAY_BACKLASH, " 2500.012");
+
+    controlPanel.setMessage(MESSAGE);
+    checkRefresh("message", DISPLAY_RPM, "BACKLASH");
+    controlPanel.setMessage(NULL);
+
+    leds.all = LED_TPI | LED_THREAD | LED_REVERSE;
+    controlPanel.setLEDs(leds);
+    controlPanel.setRPM(0);
+    checkRefresh("message cleared", DISPLAY_RPM, "   00.012");
+    check("LEDs changed", panel.getLEDs() == leds.all);
+}
+
+void PanelTest :: testBrightness(void)
+{
+    controlPanel.refresh(DISPLAY_RPM);
+    check("default brightness", panel.getBrightness() == 3);
+
+    controlPanel.setBrightness(0);
+    controlPanel.refresh(DISPLAY_RPM);
+    check("display off", panel.getBrightness() == 0);
+
+    controlPanel.setBrightness(20);
+    controlPanel.refresh(DISPLAY_RPM);
+    check("brightness limited", panel.getBrightness() == 8);
+}
+
+void PanelTest :: testKeys(void)
+{
+    KEY_EVENT event;
+
+    check("key scan bytes", scan(1) == SCAN_BYTES);
+    check("no events with no keys", countEvents(KEY_PRESSED, 0, &event) == 0);
+
+    panel.setKeys(KEY_FEED_THREAD);
+    scan(DEBOUNCE_SCANS - 1);
+    check("key not pressed before it settles", countEvents(KEY_PRESSED, KEY_FEED_THREAD, &event) == 0);
+    scan(1);
+    check("key pressed once it settles", countEvents(KEY_PRESSED, KEY_FEED_THREAD, &event) == 1);
+    check("key held", controlPanel.getHeldKeys().all == KEY_FEED_THREAD);
+
+    // only UP and DOWN repeat
+    scan(KEY_SCAN_RATE_HZ);
+    check("held key does not repeat", countEvents(KEY_REPEATED, KEY_FEED_THREAD, &event) == 0);
+
+    panel.setKeys(0);
+    scan(DEBOUNCE_SCANS);
+    check("key released", countEvents(KEY_RELEASED, KEY_FEED_THREAD, &event) == 1);
+
+    // a held UP repeats after the delay, then at the interval
+    panel.setKeys(KEY_UP);
+    scan(DEBOUNCE_SCANS);
+    countEvents(KEY_PRESSED, KEY_UP, &event);
+    Uint32 pressed = event.time;
+    scan((KEY_REPEAT_DELAY_MS + 3 * KEY_REPEAT_INTERVAL_MS) * KEY_SCAN_RATE_HZ / 1000);
+    check("held key repeats", countEvents(KEY_REPEATED, KEY_UP, &event) == 4 &&
+            event.time - pressed == KEY_REPEAT_DELAY_MS + 3 * KEY_REPEAT_INTERVAL_MS);
+    panel.setKeys(0);
+    scan(DEBOUNCE_SCANS);
+    countEvents(KEY_RELEASED, KEY_UP, &event);
+
+    // two keys at once read as a bad transfer
+    panel.setKeys(KEY_DOWN | KEY_SET);
+    scan(DEBOUNCE_SCANS * 2);
+    check("two keys ignored", countEvents(KEY_PRESSED, 0, &event) == 0);
+    panel.setKeys(0);
+
+    // the main loop holds the bus: scans must leave it alone
+    spiBus.lock();
+    check("no scan while the bus is locked", scan(DEBOUNCE_SCANS) == 0 && panel.getBytes() == 0);
+    spiBus.unlock();
+}
+
+Uint16 PanelTest :: getFailures(void)
+{
+    return this->failures;
+}
+
+
+int main(void)
+{
+    PanelTest test;
+
+    test.testDisplay();
+    test.testBrightness();
+    test.testKeys();
+
+    printf("\n%u checks failed\n", (unsigned)test.getFailures());
+    return (test.getFailures() == 0) ? 0 : 1;
+}
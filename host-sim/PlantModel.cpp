@@ -0,0 +1,429 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//
+// Stepper plant model
+//
+// Runs the real Core and StepperDrive ISRs against a simulated spindle that
+// speeds up to a given RPM, holds it, stops, and does the same in reverse,
+// and feeds the STEP/DIR edges they write to a StepperPlant: a virtual
+// stepper or servo with its drive's input timing, a torque-speed curve and
+// the inertia of the leadscrew.  Reports timing violations, stalls, the
+// following error against what stalls the motor, the peak step rate, and
+// the fastest spindle speed the row runs at cleanly, with the step rate it
+// needs.  The UI loop's step backlog check runs too, since the leadscrew
+// falling behind ends a run as surely as a stall.
+//
+// usage: plant-model
+//        plant-model <inch|metric> <feed|thread> <row> <rpm>
+//
+// With no arguments, runs the default feed, and the coarsest metric thread,
+// on each plant, checks that the default feed runs cleanly and that a drive
+// needing longer pulses than the firmware gives is caught, and fails if not.
+//
+// The plants below are examples; put in the numbers for your own motor,
+// drive and leadscrew.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "Tables.h"
+#include "Core.h"
+#include "Encoder.h"
+#include "StepperDrive.h"
+#include "StepperPlant.h"
+
+
+// The host GPIO registers are memory, not strobes, so two writes to GPASET in
+// one ISR leave only the second; that happens when the drive changes
+// direction and steps at once
+#if DIR_SETUP_CYCLES == 0
+#error the plant model needs STEPPER_DIR_SETUP_US above zero
+#endif
+
+// spindle profile: speed up, hold, slow down, pause, then the same in reverse
+#define SPINDLE_RAMP_MS 500
+#define SPINDLE_HOLD_MS 500
+#define SPINDLE_PAUSE_MS 50
+
+// the user interface checks the step backlog once a loop
+#define BACKLOG_CHECK_MS (1000 / UI_REFRESH_RATE_HZ)
+
+// fastest spindle speed tried when looking for the limit
+#define SEARCH_TOP_RPM 3000
+
+// default spindle speed with no arguments
+#define DEFAULT_RPM 600
+
+#define STEPPER_CYCLE_NS (STEPPER_CYCLE_US * 1000ULL)
+#define NS_PER_MS 1000000ULL
+
+// fastest the drive's state machine steps, with the configured step timing
+#define FIRMWARE_MAX_STEP_HZ (1000000UL / STEPPER_CYCLE_US / (STEP_HIGH_CYCLES + STEP_LOW_CYCLES))
+
+static const STEPPER_PINS leadscrewPins = Z_STEPPER_PINS;
+
+static const PLANT PLANTS[] =
+{
+    {
+        // NEMA 23 hybrid stepper on a microstepping drive at 48V
+        "stepper", PLANT_STEPPER,
+        2500, 2500, 5000, 5000,
+        STEPPER_RESOLUTION, STEPPER_MICROSTEPS,
+        2.0, 300, 2000,
+        1.1e-4, 0.15, 0.02,
+        0, 0
+    },
+    {
+        // 400W AC servo, with electronic gearing to match
+        "servo", PLANT_SERVO,
+        2500, 2500, 5000, 5000,
+        STEPPER_RESOLUTION, STEPPER_MICROSTEPS,
+        3.8, 3000, 5000,
+        1.4e-4, 0.15, 0.1,
+        50, 800
+    }
+};
+#define PLANT_COUNT (sizeof(PLANTS) / sizeof(PLANTS[0]))
+
+// a drive that wants longer step pulses than the firmware gives, which the
+// timing check has to catch
+static const PLANT SLOW_DRIVE =
+{
+    "slow drive", PLANT_STEPPER,
+    (STEP_HIGH_CYCLES + 1) * STEPPER_CYCLE_NS, 2500, 5000, 5000,
+    STEPPER_RESOLUTION, STEPPER_MICROSTEPS,
+    2.0, 300, 2000,
+    1.1e-4, 0.15, 0.02,
+    0, 0
+};
+
+static const char *TIMING_NAMES[TIMING_KINDS] = { "high", "low", "setup", "hold", "glitch" };
+
+typedef struct RUN
+{
+    bool backlog;           // the leadscrew fell too far behind and stopped
+    Uint64 backlogNs;
+    PLANT_RESULT plant;     // what the plant saw, by the end of the run
+} RUN;
+
+
+class PlantModel
+{
+private:
+    volatile struct EQEP_REGS encoderRegs;
+
+    int32 spindleSpeed(Uint64 nowNs, Uint32 rpm);
+
+public:
+    // run the spindle profile at <rpm> with <row> selected; true if the plant
+    // saw no timing violation or stall and the step backlog held
+    bool run(const FEED_THREAD *row, Uint32 rpm, StepperPlant *plant, RUN *run);
+
+    // the fastest clean spindle speed, or 0 if there is none; *failed gets
+    // the run just above it
+    Uint32 search(const FEED_THREAD *row, StepperPlant *plant, RUN *failed);
+};
+
+
+// spindle speed at <nowNs> into the profile, in RPM scaled by 1000
+int32 PlantModel :: spindleSpeed(Uint64 nowNs, Uint32 rpm)
+{
+    const Uint64 ramp = SPINDLE_RAMP_MS * NS_PER_MS;
+    const Uint64 hold = SPINDLE_HOLD_MS * NS_PER_MS;
+    const Uint64 half = 2 * ramp + hold + SPINDLE_PAUSE_MS * NS_PER_MS;
+
+    int32 sign = (nowNs < half) ? 1 : -1;
+    Uint64 t = nowNs % half;
+    Uint64 milli;
+
+    if( t < ramp ) {
+        milli = rpm * 1000ULL * t / ramp;
+    }
+    else if( t < ramp + hold ) {
+        milli = rpm * 1000ULL;
+    }
+    else if( t < 2 * ramp + hold ) {
+        milli = rpm * 1000ULL * (2 * ramp + hold - t) / ramp;
+    }
+    else {
+        milli = 0;
+    }
+    return sign * (int32)milli;
+}
+
+bool PlantModel :: run(const FEED_THREAD *row, Uint32 rpm, StepperPlant *plant, RUN *run)
+{
+    // a fresh machine for every run, as at power-up
+    Encoder encoder(&encoderRegs);
+    StepperDrive drive(&leadscrewPins);
+    Core core(&encoder, &drive);
+
+    const Uint32 modulus = _ENCODER_MAX_COUNT;
+    const Uint64 end = 2 * (2 * SPINDLE_RAMP_MS + SPINDLE_HOLD_MS + SPINDLE_PAUSE_MS) * NS_PER_MS;
+
+    this->encoderRegs.QPOSCNT = ENCODER_RESOLUTION;
+    GpioDataRegs.GPASET.all = 0;
+    GpioDataRegs.GPACLEAR.all = 0;
+
+    drive.initHardware();
+    drive.setBacklash(BACKLASH_STEPS);
+    core.setFeed(row);
+    core.setReverse(false);
+
+    plant->reset();
+    plant->sample(0);
+
+    memset(run, 0, sizeof(*run));
+
+    // encoder counts, in 1/(1000 * 60 * 10^9) of a count
+    Uint64 fraction = 0;
+    const Uint64 unit = 1000ULL * 60 * 1000000000ULL;
+    Uint64 nextBacklogCheck = BACKLOG_CHECK_MS * NS_PER_MS;
+
+    for( Uint64 now = STEPPER_CYCLE_NS; now < end; now += STEPPER_CYCLE_NS ) {
+        int32 speed = spindleSpeed(now, rpm);
+        Uint32 magnitude = (speed < 0) ? -speed : speed;
+
+        fraction += (Uint64)magnitude * ENCODER_RESOLUTION * STEPPER_CYCLE_NS;
+        Uint32 counts = fraction / unit;
+        fraction %= unit;
+
+        Uint32 position = this->encoderRegs.QPOSCNT;
+        if( speed >= 0 ) {
+            position = (position + counts) % modulus;
+        }
+        else {
+            position = (position + modulus - counts % modulus) % modulus;
+        }
+        this->encoderRegs.QPOSCNT = position;
+
+        core.ISR();
+        plant->sample(now);
+
+        if( now >= nextBacklogCheck ) {
+            nextBacklogCheck += BACKLOG_CHECK_MS * NS_PER_MS;
+            if( drive.checkStepBacklog() ) {
+                run->backlog = true;
+                run->backlogNs = now;
+                break;
+            }
+        }
+        if( plant->getResult()->stalled ) {
+            break;
+        }
+    }
+
+    run->plant = *plant->getResult();
+    return ! run->backlog && ! run->plant.stalled && plant->getViolations() == 0;
+}
+
+Uint32 PlantModel :: search(const FEED_THREAD *row, StepperPlant *plant, RUN *failed)
+{
+    RUN trial;
+
+    if( run(row, SEARCH_TOP_RPM, plant, &trial) ) {
+        return SEARCH_TOP_RPM;
+    }
+    *failed = trial;
+
+    // the fastest clean speed lies in [low, high)
+    Uint32 low = 0;
+    Uint32 high = SEARCH_TOP_RPM;
+    while( high - low > 1 ) {
+        Uint32 middle = (low + high) / 2;
+        if( run(row, middle, plant, &trial) ) {
+            low = middle;
+        }
+        else {
+            high = middle;
+            *failed = trial;
+        }
+    }
+    return low;
+}
+
+
+// steps per second a row needs at a spindle speed
+static double stepRate(const FEED_THREAD *row, Uint32 rpm)
+{
+    return (double)rpm / 60 * ENCODER_RESOLUTION * row->numerator / row->denominator;
+}
+
+static const char *describe(const RUN *run, char *text, size_t size)
+{
+    const PLANT_RESULT *result = &run->plant;
+
+    if( result->stalled ) {
+        snprintf(text, size, "stalled at %.3fs", result->stallNs / 1e9);
+    }
+    else if( run->backlog ) {
+        snprintf(text, size, "fell behind at %.3fs", run->backlogNs / 1e9);
+    }
+    else if( result->firstViolationNs > 0 ) {
+        size_t length = snprintf(text, size, "timing from %.6fs:", result->firstViolationNs / 1e9);
+        for( int kind = 0; kind < TIMING_KINDS && length < size; kind++ ) {
+            if( result->violations[kind] > 0 ) {
+                length += snprintf(text + length, size - length, " %lu %s",
+                        (unsigned long)result->violations[kind], TIMING_NAMES[kind]);
+            }
+        }
+    }
+    else {
+        snprintf(text, size, "ok");
+    }
+    return text;
+}
+
+static void printRun(const char *name, const RUN *run, StepperPlant *plant)
+{
+    char text[128];
+    const PLANT_RESULT *result = &run->plant;
+
+    printf("  %-10s %8lu steps %5lu reversals, peak %7.0f steps/s, motor %5.0f rpm, "
+            "following %6.1f of %6.1f steps: %s\n",
+            name, (unsigned long)result->steps, (unsigned long)result->reversals,
+            (result->shortestPeriodNs > 0) ? 1e9 / result->shortestPeriodNs : 0.0,
+            result->maxRpm, result->maxFollowing, plant->stallFollowing(),
+            describe(run, text, sizeof(text)));
+}
+
+static void printSearch(const char *name, const FEED_THREAD *row, Uint32 rpm, const RUN *failed)
+{
+    char text[128];
+
+    if( rpm >= SEARCH_TOP_RPM ) {
+        printf("  %-10s clean to %u rpm and beyond, %.0f steps/s\n",
+                name, (unsigned)rpm, stepRate(row, rpm));
+    }
+    else {
+        printf("  %-10s clean to %u rpm, %.0f steps/s; above that %s\n",
+                name, (unsigned)rpm, stepRate(row, rpm), describe(failed, text, sizeof(text)));
+    }
+}
+
+// one row at one speed, on every plant, then the fastest each can run it
+static void runRow(PlantModel *model, const char *table, Uint16 index, const FEED_THREAD *row,
+        Uint32 rpm, RUN results[PLANT_COUNT])
+{
+    printf("%s row %u at %u rpm, %.0f steps/s:\n", table, (unsigned)index, (unsigned)rpm,
+            stepRate(row, rpm));
+
+    for( Uint16 i = 0; i < PLANT_COUNT; i++ ) {
+        StepperPlant plant(&PLANTS[i], &leadscrewPins);
+        model->run(row, rpm, &plant, &results[i]);
+        printRun(PLANTS[i].name, &results[i], &plant);
+    }
+    for( Uint16 i = 0; i < PLANT_COUNT; i++ ) {
+        StepperPlant plant(&PLANTS[i], &leadscrewPins);
+        RUN failed;
+        Uint32 limit = model->search(row, &plant, &failed);
+        printSearch(PLANTS[i].name, row, limit, &failed);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    FeedTableFactory feedTableFactory;
+    PlantModel model;
+    RUN results[PLANT_COUNT];
+
+    printf("stepper ISR every %uus, at most %lu steps/s\n\n",
+            (unsigned)STEPPER_CYCLE_US, (unsigned long)FIRMWARE_MAX_STEP_HZ);
+
+    if( argc == 5 ) {
+        bool metric = strcmp(argv[1], "metric") == 0;
+        bool thread = strcmp(argv[2], "thread") == 0;
+        FeedTable *table = feedTableFactory.getFeedTable(metric, thread);
+        Uint16 index = strtoul(argv[3], NULL, 10);
+        Uint32 rpm = strtoul(argv[4], NULL, 10);
+
+        if( (! metric && strcmp(argv[1], "inch") != 0) || (! thread && strcmp(argv[2], "feed") != 0) ||
+                index >= table->size() || rpm < 1 || rpm > SEARCH_TOP_RPM ) {
+            fprintf(stderr, "usage: plant-model <inch|metric> <feed|thread> <row> <rpm 1-%u>\n",
+                    (unsigned)SEARCH_TOP_RPM);
+            return 2;
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "%s %s", argv[1], argv[2]);
+        runRow(&model, name, index, table->row(index), rpm, results);
+        return 0;
+    }
+    if( argc != 1 ) {
+        fprintf(stderr, "usage: plant-model [<inch|metric> <feed|thread> <row> <rpm>]\n");
+        return 2;
+    }
+
+    Uint16 failures = 0;
+
+    // the default feed has to run cleanly on every plant
+    FeedTable *feeds = feedTableFactory.getFeedTable(true, false);
+    Uint16 selection = feeds->getSelection();
+    const FEED_THREAD *feed = feeds->current();
+    runRow(&model, "metric feed", selection, feed, DEFAULT_RPM, results);
+    for( Uint16 i = 0; i < PLANT_COUNT; i++ ) {
+        StepperPlant plant(&PLANTS[i], &leadscrewPins);
+        if( ! model.run(feed, DEFAULT_RPM, &plant, &results[i]) ) {
+            printf("FAIL: %s does not run the default feed\n", PLANTS[i].name);
+            failures++;
+        }
+    }
+
+    // the coarsest metric thread; the stepper has to run out of torque
+    // somewhere, or the model isn't modelling anything
+    FeedTable *threads = feedTableFactory.getFeedTable(true, true);
+    Uint16 coarsest = threads->size() - 1;
+    runRow(&model, "metric thread", coarsest, threads->row(coarsest), DEFAULT_RPM, results);
+    {
+        StepperPlant plant(&PLANTS[0], &leadscrewPins);
+        RUN failed;
+        if( model.search(threads->row(coarsest), &plant, &failed) >= SEARCH_TOP_RPM ) {
+            printf("FAIL: the stepper never stalls\n");
+            failures++;
+        }
+    }
+
+    // and a drive that needs longer step pulses is caught
+    {
+        StepperPlant plant(&SLOW_DRIVE, &leadscrewPins);
+        RUN run;
+        model.run(feed, DEFAULT_RPM, &plant, &run);
+        printf("metric feed row %u at %u rpm:\n", (unsigned)selection, (unsigned)DEFAULT_RPM);
+        printRun(SLOW_DRIVE.name, &run, &plant);
+        if( run.plant.violations[TIMING_STEP_HIGH] == 0 ) {
+            printf("FAIL: short step pulses not caught\n");
+            failures++;
+        }
+    }
+
+    printf("\n%u failures\n", (unsigned)failures);
+    return (failures == 0) ? 0 : 1;
+}
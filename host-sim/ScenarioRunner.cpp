@@ -0,0 +1,788 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+//
+// UI scenario runner
+//
+// Builds the machine the way main.cpp does, on the TM1638 and EEPROM
+// emulators and a simulated spindle encoder, and runs a script of timed key
+// presses and spindle speeds against it.  The stepper ISR, the key scan and
+// the user interface loop run at their configured rates on the host clock;
+// the SPI bus and DELAY_US take as long as they would on the target, so a
+// loop pass costs what it would there, give or take the CPU time.  Passes
+// and scans do not preempt each other: an ISR due during a pass runs late,
+// when the pass ends.
+//
+// The script checks the display, the LEDs and the feed the Core is
+// following, how long each takes to change after a key, and the time budget
+// for each loop pass and key scan.
+//
+// usage: scenario-runner <script>
+//
+// Script lines, run in order; # starts a comment:
+//
+//   run <ms>                   let the machine run
+//   rpm <rpm>                  spindle speed from now on; negative for reverse
+//   press <key> [<ms>]         hold a key, 100ms unless given, then let it go
+//                              for as long, so presses in a row are separate
+//   hold <key>                 hold a key down until release
+//   release                    let go of all the keys
+//   expect display "<text>"    the display shows text, as TM1638Emulator::shows()
+//   expect leds <led>...       exactly these LEDs are lit, or none
+//   expect feed <inch|metric> <feed|thread> <row> [forward|reverse]
+//                              the Core follows this row of that table
+//   expect writes <count>      EEPROM write cycles since the start
+//   within <ms> <expectation>  run until the expectation holds, at most ms
+//   budget pass|scan <ms>      from now on, fail any loop pass or key scan
+//                              that takes longer; 0 for no budget
+//   show                       print the display, LEDs, feed, RPM and carriage
+//
+// Keys: UP DOWN IN_MM FEED_THREAD FWD_REV SET POWER
+// LEDs: TPI INCH MM THREAD FEED REVERSE FORWARD POWER
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#include "F28x_Project.h"
+#include "Configuration.h"
+#include "ControlPanel.h"
+#include "EEPROM.h"
+#include "Settings.h"
+#include "StepperDrive.h"
+#include "Encoder.h"
+#include "Core.h"
+#include "Tables.h"
+#include "UserInterface.h"
+#include "BlackBox.h"
+#include "HostClock.h"
+#include "HostSPIBus.h"
+#include "TM1638Emulator.h"
+#include "EEPROMEmulator.h"
+
+
+// how long a press holds the key, unless the script says
+#define DEFAULT_PRESS_MS 100
+
+// how often a within checks its expectation
+#define WITHIN_STEP_NS 1000000ULL
+
+#define NS_PER_MS 1000000ULL
+#define STEPPER_CYCLE_NS (STEPPER_CYCLE_US * 1000ULL)
+#define KEY_SCAN_NS (1000000000ULL / KEY_SCAN_RATE_HZ)
+#define UI_REFRESH_NS (1000000000ULL / UI_REFRESH_RATE_HZ)
+#define UNIT_TIMEOUT_NS (1000000000ULL / RPM_CALC_RATE_HZ)
+
+// spindle counts per minute of time, per RPM
+#define COUNTS_PER_RPM_NS (60ULL * 1000000000ULL)
+
+// longest script line
+#define LINE_SIZE 256
+
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct NAMED_BIT
+{
+    const char *name;
+    Uint16 bit;
+} NAMED_BIT;
+
+static const NAMED_BIT KEY_NAMES[] = {
+    { "UP", 1<<0 }, { "DOWN", 1<<2 }, { "IN_MM", 1<<3 }, { "FEED_THREAD", 1<<4 },
+    { "FWD_REV", 1<<5 }, { "SET", 1<<6 }, { "POWER", 1<<7 },
+};
+
+static const NAMED_BIT LED_NAMES[] = {
+    { "TPI", LED_TPI }, { "INCH", LED_INCH }, { "MM", LED_MM }, { "THREAD", LED_THREAD },
+    { "FEED", LED_FEED }, { "REVERSE", LED_REVERSE }, { "FORWARD", LED_FORWARD }, { "POWER", LED_POWER },
+};
+
+#define KEY_COUNT (sizeof(KEY_NAMES) / sizeof(KEY_NAMES[0]))
+#define LED_COUNT (sizeof(LED_NAMES) / sizeof(LED_NAMES[0]))
+
+static const STEPPER_PINS leadscrewPins = Z_STEPPER_PINS;
+
+
+//
+// The firmware, wired up as main.cpp does for the features this build has,
+// and the simulated hardware around it
+//
+class Machine
+{
+public:
+    // the hardware
+    TM1638Emulator panel;
+    EEPROMEmulator eepromChip;
+    volatile struct EQEP_REGS encoderRegs;
+
+    // the firmware
+    FeedTableFactory feedTableFactory;
+    SPIBus spiBus;
+    ControlPanel controlPanel;
+    EEPROM eeprom;
+    Settings settings;
+    Encoder encoder;
+    StepperDrive stepperDrive;
+    Core core;
+    UserInterface userInterface;
+#ifdef USE_BLACKBOX
+    BlackBox blackBox;
+#endif // USE_BLACKBOX
+
+    // budgets, in nanoseconds, and what ran over them
+    Uint64 passBudget;
+    Uint64 scanBudget;
+    Uint32 passesOverBudget;
+    Uint32 scansOverBudget;
+
+    // timing so far
+    Uint32 passes;
+    Uint64 maxPassTime;
+    Uint32 scans;
+    Uint64 maxScanTime;
+    Clock::duration passHostTime;
+    Clock::duration maxPassHostTime;
+
+private:
+    // when each next falls due
+    Uint64 nextStepper;
+    Uint64 nextScan;
+    Uint64 nextPass;
+    Uint64 nextUnitTimeout;
+
+    // spindle speed, and counts owed to the encoder in 1/COUNTS_PER_RPM_NS
+    int32 rpm;
+    Uint64 countFraction;
+
+    void stepperISR(void);
+    void keyScan(void);
+    void loopPass(void);
+    void turnSpindle(void);
+
+public:
+    Machine(void);
+
+    // initialize everything, as main() does before its loop
+    void start(void);
+
+    // run until the host clock reaches <until>
+    void run(Uint64 until);
+
+    void setRPM(int32 rpm);
+};
+
+
+Machine :: Machine(void) :
+        controlPanel(&spiBus),
+        eeprom(&spiBus),
+        settings(&eeprom),
+        encoder(&encoderRegs),
+        stepperDrive(&leadscrewPins),
+        core(&encoder, &stepperDrive),
+        userInterface(&controlPanel, &core, &feedTableFactory)
+#ifdef USE_BLACKBOX
+        , blackBox(&eeprom, &encoder, &stepperDrive, &core)
+#endif // USE_BLACKBOX
+{
+    this->passBudget = 0;
+    this->scanBudget = 0;
+    this->passesOverBudget = 0;
+    this->scansOverBudget = 0;
+    this->passes = 0;
+    this->maxPassTime = 0;
+    this->scans = 0;
+    this->maxScanTime = 0;
+    this->passHostTime = Clock::duration::zero();
+    this->maxPassHostTime = Clock::duration::zero();
+    this->nextStepper = 0;
+    this->nextScan = 0;
+    this->nextPass = 0;
+    this->nextUnitTimeout = 0;
+    this->rpm = 0;
+    this->countFraction = 0;
+}
+
+void Machine :: start(void)
+{
+    hostSpiAttach(NULL);
+    hostSpiAttach(&panel);
+    hostSpiAttach(&eepromChip);
+
+    // the drive is healthy
+    GpioDataRegs.GPADAT.all = 0;
+    if( stepperDrive.isAlarm() ) {
+        GpioDataRegs.GPADAT.all = leadscrewPins.alarm;
+    }
+
+    spiBus.initHardware();
+    controlPanel.initHardware();
+    eeprom.initHardware();
+    stepperDrive.initHardware();
+    encoder.initHardware();
+
+    // the eQEP starts counting from QPOSINIT
+    encoderRegs.QPOSCNT = encoderRegs.QPOSINIT;
+    encoderRegs.QPOSLAT = encoderRegs.QPOSINIT;
+
+    settings.load();
+    stepperDrive.setBacklash(settings.getBacklashSteps());
+    userInterface.setSettings(&settings);
+
+#ifdef USE_BLACKBOX
+    blackBox.load();
+    userInterface.setBlackBox(&blackBox);
+#endif // USE_BLACKBOX
+
+    Uint64 now = hostClockNow();
+    this->nextStepper = now;
+    this->nextScan = now;
+    this->nextPass = now;
+    this->nextUnitTimeout = now + UNIT_TIMEOUT_NS;
+}
+
+void Machine :: setRPM(int32 rpm)
+{
+    this->rpm = rpm;
+}
+
+void Machine :: turnSpindle(void)
+{
+    Uint32 speed = (this->rpm < 0) ? -this->rpm : this->rpm;
+
+    this->countFraction += (Uint64)speed * ENCODER_RESOLUTION * STEPPER_CYCLE_NS;
+    Uint32 counts = this->countFraction / COUNTS_PER_RPM_NS;
+    this->countFraction %= COUNTS_PER_RPM_NS;
+
+    // QPOSCNT runs from 0 to QPOSMAX and wraps
+    Uint32 modulus = encoderRegs.QPOSMAX + 1;
+    Uint32 position = encoderRegs.QPOSCNT;
+    if( this->rpm >= 0 ) {
+        position = (position + counts) % modulus;
+    }
+    else {
+        position = (position + modulus - counts % modulus) % modulus;
+    }
+    encoderRegs.QPOSCNT = position;
+
+    // the unit timer latches the count; clearing the flag is a write to QCLR
+    if( encoderRegs.QCLR.bit.UTO ) {
+        encoderRegs.QFLG.bit.UTO = 0;
+        encoderRegs.QCLR.bit.UTO = 0;
+    }
+    if( this->nextStepper >= this->nextUnitTimeout ) {
+        encoderRegs.QPOSLAT = position;
+        encoderRegs.QFLG.bit.UTO = 1;
+        this->nextUnitTimeout += UNIT_TIMEOUT_NS;
+    }
+}
+
+void Machine :: stepperISR(void)
+{
+    turnSpindle();
+
+    // CPU timer 2 counts down at SYSCLK, as Debug sets it up
+    CpuTimer2Regs.TIM.all = 0xFFFFFFFF - (Uint32)(hostClockNow() / CPU_RATE);
+
+    // as cpu_timer0_isr
+    core.ISR();
+#ifdef USE_BLACKBOX
+    blackBox.ISR();
+#endif // USE_BLACKBOX
+}
+
+void Machine :: keyScan(void)
+{
+    Uint64 start = hostClockNow();
+
+    // as epwm8_isr
+    controlPanel.scanKeys();
+
+    Uint64 time = hostClockNow() - start;
+    this->scans++;
+    if( time > this->maxScanTime ) {
+        this->maxScanTime = time;
+    }
+    if( this->scanBudget != 0 && time > this->scanBudget ) {
+        this->scansOverBudget++;
+    }
+}
+
+void Machine :: loopPass(void)
+{
+    Uint64 start = hostClockNow();
+    Clock::time_point hostStart = Clock::now();
+
+    // as the loop in main()
+    if( stepperDrive.checkStepBacklog() ) {
+        userInterface.panicStepBacklog();
+    }
+#ifdef USE_BLACKBOX
+    blackBox.loop();
+#endif // USE_BLACKBOX
+    userInterface.loop();
+
+    Clock::duration hostTime = Clock::now() - hostStart;
+    this->passHostTime += hostTime;
+    if( hostTime > this->maxPassHostTime ) {
+        this->maxPassHostTime = hostTime;
+    }
+
+    Uint64 time = hostClockNow() - start;
+    this->passes++;
+    if( time > this->maxPassTime ) {
+        this->maxPassTime = time;
+    }
+    if( this->passBudget != 0 && time > this->passBudget ) {
+        this->passesOverBudget++;
+    }
+}
+
+void Machine :: run(Uint64 until)
+{
+    for(;;) {
+        Uint64 now = hostClockNow();
+        Uint64 next = this->nextStepper;
+        if( this->nextScan < next ) next = this->nextScan;
+        if( this->nextPass < next ) next = this->nextPass;
+
+        if( next >= until ) {
+            if( now < until ) {
+                hostClockAdvance(until - now);
+            }
+            return;
+        }
+        if( next > now ) {
+            hostClockAdvance(next - now);
+        }
+
+        // the stepper interrupt has the highest priority; a pass delays
+        // UI_REFRESH_RATE_HZ after it ends
+        if( this->nextStepper == next ) {
+            stepperISR();
+            this->nextStepper += STEPPER_CYCLE_NS;
+        }
+        else if( this->nextScan == next ) {
+            keyScan();
+            this->nextScan += KEY_SCAN_NS;
+        }
+        else {
+            loopPass();
+            this->nextPass = hostClockNow() + UI_REFRESH_NS;
+        }
+    }
+}
+
+
+//
+// Reads the script and checks the machine against it
+//
+class ScenarioRunner
+{
+private:
+    Machine machine;
+
+    const char *fileName;
+    Uint16 lineNumber;
+    Uint16 failures;
+
+    // keys held down
+    Uint16 keys;
+
+    void runFor(Uint64 nanoseconds);
+    bool parseBits(const NAMED_BIT *names, Uint16 count, const char *name, Uint16 *bit);
+    bool parseText(char **cursor, char *text);
+    bool isFeed(const char *arguments, char *actual);
+    bool isMet(const char *expectation, char *actual, bool *valid);
+    void describe(char *text);
+    void fail(const char *line, const char *why);
+    bool runLine(char *line);
+
+public:
+    ScenarioRunner(const char *fileName);
+
+    bool run(FILE *script);
+
+    void report(void);
+    Uint16 getFailures(void);
+};
+
+
+ScenarioRunner :: ScenarioRunner(const char *fileName)
+{
+    this->fileName = fileName;
+    this->lineNumber = 0;
+    this->failures = 0;
+    this->keys = 0;
+}
+
+void ScenarioRunner :: runFor(Uint64 nanoseconds)
+{
+    machine.run(hostClockNow() + nanoseconds);
+}
+
+bool ScenarioRunner :: parseBits(const NAMED_BIT *names, Uint16 count, const char *name, Uint16 *bit)
+{
+    for( Uint16 i=0; i < count; i++ ) {
+        if( strcmp(names[i].name, name) == 0 ) {
+            *bit = names[i].bit;
+            return true;
+        }
+    }
+    return false;
+}
+
+// take a quoted string from the line
+bool ScenarioRunner :: parseText(char **cursor, char *text)
+{
+    char *start = strchr(*cursor, '"');
+    if( start == NULL ) {
+        return false;
+    }
+    char *end = strchr(start + 1, '"');
+    if( end == NULL || end - start - 1 >= TM1638_TEXT_SIZE ) {
+        return false;
+    }
+    memcpy(text, start + 1, end - start - 1);
+    text[end - start - 1] = '\0';
+    *cursor = end + 1;
+    return true;
+}
+
+// is the Core following the feed in <arguments>?
+bool ScenarioRunner :: isFeed(const char *arguments, char *actual)
+{
+    char units[16], type[16], direction[16] = "";
+    unsigned row;
+
+    if( sscanf(arguments, "%15s %15s %u %15s", units, type, &row, direction) < 3 ||
+        (strcmp(units, "inch") != 0 && strcmp(units, "metric") != 0) ||
+        (strcmp(type, "feed") != 0 && strcmp(type, "thread") != 0) ||
+        (direction[0] != '\0' && strcmp(direction, "forward") != 0 && strcmp(direction, "reverse") != 0) ) {
+        strcpy(actual, "bad feed");
+        return false;
+    }
+
+    FeedTable *table = machine.feedTableFactory.getFeedTable(units[0] == 'm', type[0] == 't');
+    if( row >= table->size() ) {
+        strcpy(actual, "no such row");
+        return false;
+    }
+    const FEED_THREAD *feed = table->row(row);
+
+    // compare the Core's steps for ten revolutions with the row's
+    Uint32 counts = 10UL * ENCODER_RESOLUTION;
+    int32 expected = (int32)((Uint64)counts * feed->numerator / feed->denominator);
+    int32 steps = machine.core.feedRatio(counts);
+    int32 magnitude = (steps < 0) ? -steps : steps;
+
+    describe(actual);
+    return table->getSelection() == row &&
+            magnitude >= expected - 1 && magnitude <= expected + 1 &&
+            (direction[0] == '\0' || (steps < 0) == (direction[0] == 'r'));
+}
+
+// check an expectation; <valid> is cleared if it can't be read
+bool ScenarioRunner :: isMet(const char *expectation, char *actual, bool *valid)
+{
+    char word[16];
+    int length;
+
+    *valid = true;
+    if( sscanf(expectation, "%15s%n", word, &length) < 1 ) {
+        *valid = false;
+        return false;
+    }
+    char *arguments = (char *)expectation + length;
+
+    if( strcmp(word, "display") == 0 ) {
+        char text[TM1638_TEXT_SIZE];
+        if( ! parseText(&arguments, text) ) {
+            *valid = false;
+            return false;
+        }
+        actual[0] = '"';
+        machine.panel.getText(actual + 1);
+        strcat(actual, "\"");
+        return machine.panel.shows(text);
+    }
+
+    if( strcmp(word, "leds") == 0 ) {
+        Uint16 leds = 0;
+        char name[16];
+        int used;
+        while( sscanf(arguments, "%15s%n", name, &used) == 1 ) {
+            Uint16 bit;
+            if( strcmp(name, "none") != 0 ) {
+                if( ! parseBits(LED_NAMES, LED_COUNT, name, &bit) ) {
+                    *valid = false;
+                    return false;
+                }
+                leds |= bit;
+            }
+            arguments += used;
+        }
+        Uint16 lit = machine.panel.getLEDs();
+        strcpy(actual, "leds");
+        for( Uint16 i=0; i < LED_COUNT; i++ ) {
+            if( lit & LED_NAMES[i].bit ) {
+                strcat(actual, " ");
+                strcat(actual, LED_NAMES[i].name);
+            }
+        }
+        return lit == leds;
+    }
+
+    if( strcmp(word, "writes") == 0 ) {
+        unsigned long writes;
+        if( sscanf(arguments, "%lu", &writes) != 1 ) {
+            *valid = false;
+            return false;
+        }
+        sprintf(actual, "writes %lu", (unsigned long)machine.eepromChip.getWrites());
+        return machine.eepromChip.getWrites() == writes;
+    }
+
+    if( strcmp(word, "feed") == 0 ) {
+        bool met = isFeed(arguments, actual);
+        if( strcmp(actual, "bad feed") == 0 || strcmp(actual, "no such row") == 0 ) {
+            *valid = false;
+        }
+        return met;
+    }
+
+    *valid = false;
+    return false;
+}
+
+// the table and row the Core is following, if it is a table's selection
+void ScenarioRunner :: describe(char *text)
+{
+    Uint32 counts = 10UL * ENCODER_RESOLUTION;
+    int32 steps = machine.core.feedRatio(counts);
+    int32 magnitude = (steps < 0) ? -steps : steps;
+
+    strcpy(text, "feed unknown");
+    for( int metric = 1; metric >= 0; metric-- ) {
+        for( int thread = 0; thread < 2; thread++ ) {
+            FeedTable *table = machine.feedTableFactory.getFeedTable(metric, thread);
+            const FEED_THREAD *feed = table->current();
+            int32 expected = (int32)((Uint64)counts * feed->numerator / feed->denominator);
+            if( magnitude >= expected - 1 && magnitude <= expected + 1 ) {
+                sprintf(text, "feed %s %s %u %s", metric ? "metric" : "inch", thread ? "thread" : "feed",
+                        (unsigned)table->getSelection(), (steps < 0) ? "reverse" : "forward");
+                return;
+            }
+        }
+    }
+}
+
+void ScenarioRunner :: fail(const char *line, const char *why)
+{
+    printf("%s:%u: FAIL %s: %s\n", this->fileName, (unsigned)this->lineNumber, line, why);
+    this->failures++;
+}
+
+// run one line of the script; returns false if it can't be read
+bool ScenarioRunner :: runLine(char *line)
+{
+    char command[16];
+    int length;
+    char actual[LINE_SIZE];
+    bool valid;
+    unsigned long milliseconds;
+
+    if( sscanf(line, "%15s%n", command, &length) < 1 ) {
+        return true;
+    }
+    char *arguments = line + length;
+    printf("%10.3f  %s\n", hostClockNow() / 1e9, line);
+
+    if( strcmp(command, "run") == 0 ) {
+        if( sscanf(arguments, "%lu", &milliseconds) != 1 ) return false;
+        runFor(milliseconds * NS_PER_MS);
+    }
+    else if( strcmp(command, "rpm") == 0 ) {
+        long rpm;
+        if( sscanf(arguments, "%ld", &rpm) != 1 ) return false;
+        machine.setRPM(rpm);
+    }
+    else if( strcmp(command, "press") == 0 || strcmp(command, "hold") == 0 ) {
+        char name[16];
+        Uint16 key;
+        milliseconds = DEFAULT_PRESS_MS;
+        if( sscanf(arguments, "%15s %lu", name, &milliseconds) < 1 ||
+            ! parseBits(KEY_NAMES, KEY_COUNT, name, &key) ) {
+            return false;
+        }
+        this->keys |= key;
+        machine.panel.setKeys(this->keys);
+        if( command[0] == 'p' ) {
+            runFor(milliseconds * NS_PER_MS);
+            this->keys &= ~key;
+            machine.panel.setKeys(this->keys);
+            runFor(milliseconds * NS_PER_MS);
+        }
+    }
+    else if( strcmp(command, "release") == 0 ) {
+        this->keys = 0;
+        machine.panel.setKeys(0);
+    }
+    else if( strcmp(command, "expect") == 0 ) {
+        bool met = isMet(arguments, actual, &valid);
+        if( ! valid ) return false;
+        if( ! met ) fail(line, actual);
+    }
+    else if( strcmp(command, "within") == 0 ) {
+        if( sscanf(arguments, "%lu%n", &milliseconds, &length) != 1 ) return false;
+        char *expectation = arguments + length;
+        Uint64 start = hostClockNow();
+        Uint64 end = start + milliseconds * NS_PER_MS;
+
+        bool met = isMet(expectation, actual, &valid);
+        if( ! valid ) return false;
+        while( ! met && hostClockNow() < end ) {
+            runFor(WITHIN_STEP_NS);
+            met = isMet(expectation, actual, &valid);
+        }
+        if( met ) {
+            printf("%10s  after %llu ms\n", "", (unsigned long long)((hostClockNow() - start) / NS_PER_MS));
+        }
+        else {
+            fail(line, actual);
+        }
+    }
+    else if( strcmp(command, "budget") == 0 ) {
+        char what[16];
+        if( sscanf(arguments, "%15s %lu", what, &milliseconds) != 2 ) return false;
+        if( strcmp(what, "pass") == 0 ) {
+            machine.passBudget = milliseconds * NS_PER_MS;
+        }
+        else if( strcmp(what, "scan") == 0 ) {
+            machine.scanBudget = milliseconds * NS_PER_MS;
+        }
+        else {
+            return false;
+        }
+    }
+    else if( strcmp(command, "show") == 0 ) {
+        char text[TM1638_TEXT_SIZE];
+        machine.panel.getText(text);
+        isMet("leds", actual, &valid);
+        printf("%10s  \"%s\" %s, ", "", text, actual);
+        describe(actual);
+        printf("%s, %u rpm, carriage at %ld steps\n", actual, (unsigned)machine.core.getRPM(),
+                (long)machine.core.getCarriagePosition());
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+bool ScenarioRunner :: run(FILE *script)
+{
+    char line[LINE_SIZE];
+
+    machine.start();
+
+    while( fgets(line, sizeof(line), script) != NULL ) {
+        this->lineNumber++;
+
+        // drop the comment and the line ending
+        char *end = strchr(line, '#');
+        if( end == NULL ) end = line + strlen(line);
+        while( end > line && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t') ) {
+            end--;
+        }
+        *end = '\0';
+
+        if( ! runLine(line) ) {
+            printf("%s:%u: can't read: %s\n", this->fileName, (unsigned)this->lineNumber, line);
+            return false;
+        }
+    }
+    return true;
+}
+
+void ScenarioRunner :: report(void)
+{
+    long long hostNs = std::chrono::duration_cast<std::chrono::nanoseconds>(machine.passHostTime).count();
+    long long maxHostNs = std::chrono::duration_cast<std::chrono::nanoseconds>(machine.maxPassHostTime).count();
+
+    printf("\n%u loop passes, longest %.2f ms on the target, %lld ns mean and %lld ns most on the host\n",
+            (unsigned)machine.passes, machine.maxPassTime / 1e6,
+            (machine.passes != 0) ? hostNs / machine.passes : 0, maxHostNs);
+    printf("%u key scans, longest %.2f ms\n", (unsigned)machine.scans, machine.maxScanTime / 1e6);
+    printf("%u EEPROM writes, %u EEPROM commands ignored, %u panel bytes not understood\n",
+            (unsigned)machine.eepromChip.getWrites(), (unsigned)machine.eepromChip.getErrors(),
+            (unsigned)machine.panel.getErrors());
+
+    if( machine.passesOverBudget != 0 ) {
+        printf("FAIL %u loop passes over budget\n", (unsigned)machine.passesOverBudget);
+        this->failures++;
+    }
+    if( machine.scansOverBudget != 0 ) {
+        printf("FAIL %u key scans over budget\n", (unsigned)machine.scansOverBudget);
+        this->failures++;
+    }
+    if( machine.eepromChip.getErrors() != 0 || machine.panel.getErrors() != 0 ) {
+        printf("FAIL bus errors\n");
+        this->failures++;
+    }
+}
+
+Uint16 ScenarioRunner :: getFailures(void)
+{
+    return this->failures;
+}
+
+
+int main(int argc, char **argv)
+{
+    if( argc != 2 ) {
+        fprintf(stderr, "usage: scenario-runner <script>\n");
+        return 2;
+    }
+
+    FILE *script = fopen(argv[1], "r");
+    if( script == NULL ) {
+        fprintf(stderr, "can't open %s\n", argv[1]);
+        return 2;
+    }
+
+    ScenarioRunner runner(argv[1]);
+    bool read = runner.run(script);
+    fclose(script);
+    if( ! read ) {
+        return 2;
+    }
+
+    runner.report();
+    printf("\n%u failures\n", (unsigned)runner.getFailures());
+    return (runner.getFailures() == 0) ? 0 : 1;
+}
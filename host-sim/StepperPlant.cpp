@@ -0,0 +1,250 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <math.h>
+#include <string.h>
+
+#include "StepperPlant.h"
+
+
+// smoothing of the commanded speed the damping works against, in seconds
+#define COMMAND_SPEED_TAU 0.002
+
+#define PI 3.14159265358979323846
+#define NS_PER_SECOND 1e9
+#define DT (PLANT_STEP_NS / NS_PER_SECOND)
+
+
+StepperPlant :: StepperPlant(const PLANT *plant, const STEPPER_PINS *pins)
+{
+    this->plant = plant;
+    this->stepMask = pins->step;
+    this->directionMask = pins->direction;
+    this->invertStep = pins->invert & STEPPER_INVERT_STEP;
+    this->invertDirection = pins->invert & STEPPER_INVERT_DIRECTION;
+
+    Uint32 stepsPerRevolution = (Uint32)plant->fullSteps * plant->microsteps;
+    this->stepAngle = 2 * PI / stepsPerRevolution;
+
+    if( plant->kind == PLANT_STEPPER ) {
+        // a hybrid stepper's torque goes round once every four full steps,
+        // so the rotor slips a pole once it is two full steps off its field
+        this->stallAngle = 2 * PI / plant->fullSteps * 2;
+    }
+    else {
+        this->stallAngle = plant->alarmSteps * this->stepAngle;
+    }
+
+    reset();
+}
+
+void StepperPlant :: reset(void)
+{
+    this->step = false;
+    this->direction = false;
+    this->stepOnNs = 0;
+    this->stepOffNs = 0;
+    this->directionNs = 0;
+    this->stepSeen = false;
+    this->directionSeen = false;
+
+    this->nowNs = 0;
+    this->commanded = 0;
+    this->previousCommanded = 0;
+    this->commandSpeed = 0;
+    this->angle = 0;
+    this->speed = 0;
+
+    memset(&this->result, 0, sizeof(this->result));
+}
+
+void StepperPlant :: sample(Uint64 nowNs)
+{
+    while( this->nowNs + PLANT_STEP_NS <= nowNs ) {
+        this->nowNs += PLANT_STEP_NS;
+        if( ! this->result.stalled ) {
+            integrate();
+        }
+    }
+    this->nowNs = nowNs;
+
+    readPins();
+}
+
+void StepperPlant :: readPins(void)
+{
+    Uint32 set = GpioDataRegs.GPASET.all;
+    Uint32 clear = GpioDataRegs.GPACLEAR.all;
+    Uint64 now = this->nowNs;
+
+    // the registers are strobes on the target; take this ISR's writes, so
+    // the next sample only sees new ones
+    GpioDataRegs.GPASET.all = set & ~(this->stepMask | this->directionMask);
+    GpioDataRegs.GPACLEAR.all = clear & ~(this->stepMask | this->directionMask);
+
+    if( ((set & clear) & (this->stepMask | this->directionMask)) != 0 ) {
+        this->result.violations[TIMING_GLITCH]++;
+        if( this->result.firstViolationNs == 0 ) this->result.firstViolationNs = now;
+    }
+
+    // direction first: written in the same ISR as a step, it changed before it
+    Uint32 *directionOn = this->invertDirection ? &clear : &set;
+    Uint32 *directionOff = this->invertDirection ? &set : &clear;
+    bool direction = this->direction;
+    if( *directionOn & this->directionMask ) direction = true;
+    if( *directionOff & this->directionMask ) direction = false;
+
+    if( direction != this->direction ) {
+        if( this->stepSeen ) {
+            checkTiming(TIMING_DIR_HOLD, now - this->stepOnNs, this->plant->dirHoldNs);
+        }
+        this->direction = direction;
+        this->directionNs = now;
+        this->directionSeen = true;
+        this->result.reversals++;
+    }
+
+    Uint32 *stepOn = this->invertStep ? &clear : &set;
+    Uint32 *stepOff = this->invertStep ? &set : &clear;
+
+    if( ! this->step && (*stepOn & this->stepMask) ) {
+        if( this->stepSeen ) {
+            checkTiming(TIMING_STEP_LOW, now - this->stepOffNs, this->plant->stepLowNs);
+
+            Uint64 period = now - this->stepOnNs;
+            if( this->result.shortestPeriodNs == 0 || period < this->result.shortestPeriodNs ) {
+                this->result.shortestPeriodNs = period;
+            }
+        }
+        if( this->directionSeen ) {
+            checkTiming(TIMING_DIR_SETUP, now - this->directionNs, this->plant->dirSetupNs);
+        }
+        this->step = true;
+        this->stepOnNs = now;
+        this->stepSeen = true;
+
+        this->commanded += this->direction ? 1 : -1;
+        this->result.steps++;
+    }
+    else if( this->step && (*stepOff & this->stepMask) ) {
+        checkTiming(TIMING_STEP_HIGH, now - this->stepOnNs, this->plant->stepHighNs);
+        this->step = false;
+        this->stepOffNs = now;
+    }
+}
+
+void StepperPlant :: checkTiming(PLANT_TIMING kind, Uint64 elapsedNs, Uint32 minimumNs)
+{
+    if( elapsedNs < minimumNs ) {
+        this->result.violations[kind]++;
+        if( this->result.firstViolationNs == 0 ) {
+            this->result.firstViolationNs = this->nowNs;
+        }
+    }
+}
+
+double StepperPlant :: availableTorque(void)
+{
+    double rpm = fabs(this->speed) * 60 / (2 * PI);
+
+    if( rpm <= this->plant->cornerRpm ) {
+        return this->plant->torque;
+    }
+    if( rpm >= this->plant->topRpm ) {
+        return 0;
+    }
+    return this->plant->torque * this->plant->cornerRpm / rpm;
+}
+
+void StepperPlant :: integrate(void)
+{
+    double target = this->commanded * this->stepAngle;
+    double error = target - this->angle;
+
+    // the commanded speed, smoothed, for the damping to work against
+    double moved = (this->commanded - this->previousCommanded) * this->stepAngle;
+    this->previousCommanded = this->commanded;
+    this->commandSpeed += (moved / DT - this->commandSpeed) * DT / COMMAND_SPEED_TAU;
+
+    // drive torque, within what the motor has at this speed
+    double available = availableTorque();
+    double torque;
+    if( this->plant->kind == PLANT_STEPPER ) {
+        torque = available * sin(error * this->plant->fullSteps / 4);
+    }
+    else {
+        torque = this->plant->gain * error;
+    }
+    torque += this->plant->damping * (this->commandSpeed - this->speed);
+    if( torque > available ) torque = available;
+    if( torque < -available ) torque = -available;
+
+    // friction opposes motion, and holds the rotor still until overcome
+    if( this->speed != 0 ) {
+        torque -= (this->speed > 0) ? this->plant->friction : -this->plant->friction;
+    }
+    else if( fabs(torque) <= this->plant->friction ) {
+        torque = 0;
+    }
+    else {
+        torque -= (torque > 0) ? this->plant->friction : -this->plant->friction;
+    }
+
+    double speed = this->speed + torque / this->plant->inertia * DT;
+    if( this->speed != 0 && (speed > 0) != (this->speed > 0) ) {
+        // friction stops the rotor; it doesn't turn it round
+        speed = 0;
+    }
+    this->speed = speed;
+    this->angle += this->speed * DT;
+
+    double following = fabs(target - this->angle);
+    if( following / this->stepAngle > this->result.maxFollowing ) {
+        this->result.maxFollowing = following / this->stepAngle;
+    }
+    double rpm = fabs(this->speed) * 60 / (2 * PI);
+    if( rpm > this->result.maxRpm ) {
+        this->result.maxRpm = rpm;
+    }
+    if( following > this->stallAngle ) {
+        this->result.stalled = true;
+        this->result.stallNs = this->nowNs;
+    }
+}
+
+Uint32 StepperPlant :: getViolations(void)
+{
+    Uint32 total = 0;
+    for( int kind = 0; kind < TIMING_KINDS; kind++ ) {
+        total += this->result.violations[kind];
+    }
+    return total;
+}
+
+double StepperPlant :: stallFollowing(void)
+{
+    return this->stallAngle / this->stepAngle;
+}
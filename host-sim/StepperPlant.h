@@ -0,0 +1,183 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __STEPPER_PLANT_H
+#define __STEPPER_PLANT_H
+
+//
+// A virtual drive and motor on the leadscrew STEP/DIR pins.  Reads the edges
+// the firmware writes to GPASET and GPACLEAR, checks them against the drive's
+// input timing, and turns the motor: a stepper that follows its field with
+// the torque the torque-speed curve allows and slips a pole when it falls two
+// full steps behind, or a servo whose position loop trips a following error
+// alarm.  Either way the rotor carries the inertia of everything it turns.
+//
+
+#include "F28x_Project.h"
+#include "StepperPins.h"
+
+
+// mechanics are integrated in steps of this many nanoseconds
+#define PLANT_STEP_NS 1000
+
+typedef enum PLANT_KIND
+{
+    PLANT_STEPPER,
+    PLANT_SERVO
+} PLANT_KIND;
+
+typedef enum PLANT_TIMING
+{
+    TIMING_STEP_HIGH,       // step pulse shorter than the drive accepts
+    TIMING_STEP_LOW,        // too little time between pulses
+    TIMING_DIR_SETUP,       // step too soon after a direction change
+    TIMING_DIR_HOLD,        // direction changed too soon after a step
+    TIMING_GLITCH,          // a pin set and cleared in the same ISR
+    TIMING_KINDS
+} PLANT_TIMING;
+
+//
+// The drive and motor, from their datasheets
+//
+typedef struct PLANT
+{
+    const char *name;
+    PLANT_KIND kind;
+
+    // drive input timing, in nanoseconds; the direction hold time runs from
+    // the active step edge
+    Uint32 stepHighNs;
+    Uint32 stepLowNs;
+    Uint32 dirSetupNs;
+    Uint32 dirHoldNs;
+
+    // steps per motor revolution, as the drive is set up: full steps times
+    // microsteps, or the servo's electronic gearing
+    Uint16 fullSteps;
+    Uint16 microsteps;
+
+    // torque-speed curve: full torque up to the corner speed, falling as
+    // 1/speed above it, and none beyond the top speed.  N m and RPM.
+    double torque;
+    double cornerRpm;
+    double topRpm;
+
+    // rotor plus leadscrew and carriage, referred to the motor shaft, kg m^2;
+    // friction against motion, N m; and damping of the rotor against the
+    // commanded speed, N m per rad/s
+    double inertia;
+    double friction;
+    double damping;
+
+    // servo position loop, N m per rad of following error, and the
+    // following error alarm in steps; unused for a stepper
+    double gain;
+    double alarmSteps;
+} PLANT;
+
+
+//
+// What the plant saw
+//
+typedef struct PLANT_RESULT
+{
+    Uint32 steps;               // active step edges
+    Uint32 reversals;
+    Uint64 shortestPeriodNs;    // between active step edges
+    Uint32 violations[TIMING_KINDS];
+    Uint64 firstViolationNs;
+
+    double maxFollowing;        // steps of command ahead of or behind the rotor
+    double maxRpm;              // rotor
+    bool stalled;               // slipped a pole, or tripped the alarm
+    Uint64 stallNs;
+} PLANT_RESULT;
+
+
+class StepperPlant
+{
+private:
+    const PLANT *plant;
+
+    // pins, as GPIO port A masks, and which register drives each active
+    Uint32 stepMask;
+    Uint32 directionMask;
+    bool invertStep;
+    bool invertDirection;
+
+    // pin levels, true when active, and when each last changed
+    bool step;
+    bool direction;
+    Uint64 stepOnNs;
+    Uint64 stepOffNs;
+    Uint64 directionNs;
+    bool stepSeen;
+    bool directionSeen;
+
+    // time the mechanics have been run to
+    Uint64 nowNs;
+
+    // commanded position, in steps, and its rate, smoothed, in rad/s
+    int32 commanded;
+    int32 previousCommanded;
+    double commandSpeed;
+
+    // rotor angle and speed, rad and rad/s
+    double angle;
+    double speed;
+
+    double stepAngle;
+    double stallAngle;
+
+    PLANT_RESULT result;
+
+    void readPins(void);
+    void checkTiming(PLANT_TIMING kind, Uint64 elapsedNs, Uint32 minimumNs);
+    double availableTorque(void);
+    void integrate(void);
+
+public:
+    StepperPlant(const PLANT *plant, const STEPPER_PINS *pins);
+
+    // start again at rest, at time zero, with the results cleared
+    void reset(void);
+
+    // run the motor to <nowNs>, then take the pin writes since the last call;
+    // call after every stepper ISR
+    void sample(Uint64 nowNs);
+
+    const PLANT_RESULT *getResult(void);
+    Uint32 getViolations(void);
+    // following error, in steps, at which the motor stalls or the servo alarms
+    double stallFollowing(void);
+};
+
+inline const PLANT_RESULT *StepperPlant :: getResult(void)
+{
+    return &this->result;
+}
+
+#endif // __STEPPER_PLANT_H
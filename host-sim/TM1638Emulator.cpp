@@ -0,0 +1,312 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "TM1638Emulator.h"
+
+
+// Characters the emulator can read off the display, by the segments a-g in
+// bits 0-6.  Digits come first, so 0 and 5 win over O and S.
+typedef struct GLYPH
+{
+    char character;
+    Uint16 segments;
+} GLYPH;
+
+static const GLYPH FONT[] = {
+    { '0', 0x3f }, { '1', 0x06 }, { '2', 0x5b }, { '3', 0x4f }, { '4', 0x66 },
+    { '5', 0x6d }, { '6', 0x7d }, { '7', 0x07 }, { '8', 0x7f }, { '9', 0x6f },
+    { 'A', 0x77 }, { 'B', 0x7c }, { 'C', 0x39 }, { 'D', 0x5e }, { 'E', 0x79 },
+    { 'F', 0x71 }, { 'G', 0x3d }, { 'H', 0x76 }, { 'I', 0x30 }, { 'J', 0x1e },
+    { 'K', 0x75 }, { 'L', 0x38 }, { 'M', 0x15 }, { 'N', 0x37 }, { 'O', 0x3f },
+    { 'P', 0x73 }, { 'Q', 0x67 }, { 'R', 0x33 }, { 'S', 0x6d }, { 'T', 0x78 },
+    { 'U', 0x3e }, { 'V', 0x2e }, { 'W', 0x2a }, { 'X', 0x36 }, { 'Y', 0x6e },
+    { 'Z', 0x4b }, { '-', 0x40 }, { ' ', 0x00 },
+};
+
+#define FONT_SIZE (sizeof(FONT) / sizeof(FONT[0]))
+
+// the decimal point
+#define SEGMENT_DP 0x80
+
+
+// The chip shifts least significant bit first; the SPI most significant first
+static Uint16 reverse(Uint16 value)
+{
+    Uint16 result = 0;
+
+    for( int i=0; i < 8; i++ ) {
+        result = (result << 1) | (value & 1);
+        value >>= 1;
+    }
+    return result;
+}
+
+
+TM1638Emulator :: TM1638Emulator(void)
+{
+    for( int i=0; i < 16; i++ ) {
+        this->ram[i] = 0;
+    }
+    this->address = 0;
+    this->autoIncrement = true;
+    this->addressed = false;
+    this->displayOn = false;
+    this->pulseWidth = 0;
+    this->selected = false;
+    this->commandNext = false;
+    this->reading = false;
+    this->readIndex = 0;
+    this->keys = 0;
+    this->bytes = 0;
+    this->errors = 0;
+}
+
+void TM1638Emulator :: updateSelect(void)
+{
+    bool released = GpioDataRegs.GPBSET.bit.GPIO33;
+    bool asserted = GpioDataRegs.GPBCLEAR.bit.GPIO33;
+
+    GpioDataRegs.GPBSET.bit.GPIO33 = 0;
+    GpioDataRegs.GPBCLEAR.bit.GPIO33 = 0;
+
+    // the firmware ends each transaction before it starts the next, so a
+    // release and an assert seen together came in that order
+    if( released ) {
+        this->selected = false;
+        this->reading = false;
+    }
+    if( asserted ) {
+        this->selected = true;
+        this->commandNext = true;
+        this->addressed = false;
+    }
+}
+
+bool TM1638Emulator :: shift(Uint16 out, Uint16 bits, bool talk, Uint16 *in)
+{
+    updateSelect();
+
+    if( ! this->selected ) {
+        return false;
+    }
+
+    this->bytes++;
+
+    if( bits != 8 ) {
+        this->errors++;
+        return false;
+    }
+
+    if( this->reading ) {
+        // both ends driving the line, or more than the four scan bytes
+        if( talk || this->readIndex >= 4 ) {
+            this->errors++;
+            return false;
+        }
+        *in = reverse(scanByte(this->readIndex++));
+        return true;
+    }
+
+    if( ! talk ) {
+        // clocked with nothing driving the line
+        this->errors++;
+        return false;
+    }
+
+    if( this->commandNext ) {
+        this->commandNext = false;
+        command(reverse(out));
+    }
+    else {
+        write(reverse(out));
+    }
+    return false;
+}
+
+void TM1638Emulator :: command(Uint16 value)
+{
+    switch( value & 0xC0 )
+    {
+    case 0x40:
+        // data command: write or read keys, auto-increment or fixed address
+        if( (value & 0x3B) == 0x00 ) {
+            this->autoIncrement = (value & 0x04) == 0;
+        }
+        else if( (value & 0x3B) == 0x02 ) {
+            this->reading = true;
+            this->readIndex = 0;
+        }
+        else {
+            this->errors++;
+        }
+        break;
+
+    case 0x80:
+        // display control
+        if( value & 0x30 ) {
+            this->errors++;
+        }
+        this->displayOn = (value & 0x08) != 0;
+        this->pulseWidth = value & 0x07;
+        break;
+
+    case 0xC0:
+        // address
+        if( value & 0x30 ) {
+            this->errors++;
+        }
+        this->address = value & 0x0F;
+        this->addressed = true;
+        break;
+
+    default:
+        this->errors++;
+        break;
+    }
+}
+
+void TM1638Emulator :: write(Uint16 value)
+{
+    if( ! this->addressed || this->address > 15 ) {
+        this->errors++;
+        return;
+    }
+
+    this->ram[this->address] = value;
+    if( this->autoIncrement ) {
+        this->address++;
+    }
+}
+
+Uint16 TM1638Emulator :: scanByte(Uint16 index)
+{
+    // the panel's keys are on K3, two to each scan byte: KEY_REG bits 7-4 in
+    // bit 0 of bytes 0-3, and bits 3-0 in bit 4
+    return ((this->keys >> (7 - index)) & 1) |
+           (((this->keys >> (3 - index)) & 1) << 4);
+}
+
+void TM1638Emulator :: setKeys(Uint16 keys)
+{
+    this->keys = keys;
+}
+
+bool TM1638Emulator :: isSelected(void)
+{
+    updateSelect();
+    return this->selected;
+}
+
+Uint16 TM1638Emulator :: getBrightness(void)
+{
+    return this->displayOn ? this->pulseWidth + 1 : 0;
+}
+
+Uint16 TM1638Emulator :: getLEDs(void)
+{
+    Uint16 leds = 0;
+
+    // the leftmost LED is the most significant bit
+    for( int i=0; i < 8; i++ ) {
+        if( this->ram[2*i + 1] & 1 ) {
+            leds |= 0x80 >> i;
+        }
+    }
+    return leds;
+}
+
+Uint16 TM1638Emulator :: getSegments(Uint16 digit)
+{
+    return this->ram[2*digit];
+}
+
+void TM1638Emulator :: getText(char *text)
+{
+    for( int i=0; i < 8; i++ ) {
+        Uint16 segments = this->ram[2*i];
+        char character = '?';
+
+        for( Uint16 j=0; j < FONT_SIZE; j++ ) {
+            if( FONT[j].segments == (segments & ~SEGMENT_DP) ) {
+                character = FONT[j].character;
+                break;
+            }
+        }
+
+        *text++ = character;
+        if( segments & SEGMENT_DP ) {
+            *text++ = '.';
+        }
+    }
+    *text = '\0';
+}
+
+bool TM1638Emulator :: shows(const char *text)
+{
+    for( int i=0; i < 8; i++ ) {
+        if( *text == '\0' ) {
+            return false;
+        }
+
+        Uint16 j;
+        for( j=0; j < FONT_SIZE; j++ ) {
+            if( FONT[j].character == *text ) {
+                break;
+            }
+        }
+        if( j == FONT_SIZE ) {
+            return false;
+        }
+        text++;
+
+        Uint16 segments = FONT[j].segments;
+        if( *text == '.' ) {
+            segments |= SEGMENT_DP;
+            text++;
+        }
+
+        if( this->ram[2*i] != segments ) {
+            return false;
+        }
+    }
+    return *text == '\0';
+}
+
+Uint32 TM1638Emulator :: getBytes(void)
+{
+    return this->bytes;
+}
+
+Uint32 TM1638Emulator :: getErrors(void)
+{
+    return this->errors;
+}
+
+void TM1638Emulator :: clearCounts(void)
+{
+    this->bytes = 0;
+    this->errors = 0;
+}
@@ -0,0 +1,120 @@
+// Clough42 Electronic Leadscrew
+// https://github.com/clough42/electronic-leadscrew
+//
+// MIT License
+//
+// Copyright (c) 2019 James Clough
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TM1638_EMULATOR_H
+#define __TM1638_EMULATOR_H
+
+//
+// The TM1638 on the control panel, on the host SPI bus with GPIO33 as its
+// STB line.  Decodes the commands and display data the firmware sends, as
+// the chip would, and answers key reads from a key state the test sets.
+//
+
+#include "F28x_Project.h"
+#include "HostSPIBus.h"
+
+
+// longest text getText() returns: every digit with its decimal point
+#define TM1638_TEXT_SIZE 17
+
+
+class TM1638Emulator : public HostSPIDevice
+{
+private:
+    // display RAM: segments a-g and dp in bits 0-7 at the even addresses,
+    // the LED below each digit in bit 0 at the odd ones
+    Uint16 ram[16];
+
+    // next display RAM address, and whether it advances after each write
+    Uint16 address;
+    bool autoIncrement;
+
+    // set when this transaction began with an address command, so data may
+    // follow
+    bool addressed;
+
+    // display control
+    bool displayOn;
+    Uint16 pulseWidth;
+
+    // STB state, and whether the next byte is a command
+    bool selected;
+    bool commandNext;
+
+    // key read in progress, and the next scan byte it returns
+    bool reading;
+    Uint16 readIndex;
+
+    // keys held down, in the firmware's KEY_REG layout
+    Uint16 keys;
+
+    // traffic since the counts were last cleared
+    Uint32 bytes;
+    Uint32 errors;
+
+    void updateSelect(void);
+    void command(Uint16 value);
+    void write(Uint16 value);
+    Uint16 scanByte(Uint16 index);
+
+public:
+    TM1638Emulator(void);
+
+    // HostSPIDevice
+    virtual bool shift(Uint16 out, Uint16 bits, bool talk, Uint16 *in);
+
+    // hold down keys, as a KEY_REG mask; 0 releases them all
+    void setKeys(Uint16 keys);
+
+    // is STB low?
+    bool isSelected(void);
+
+    // brightness as ControlPanel::setBrightness() takes it: 1-8, or 0 if off
+    Uint16 getBrightness(void);
+
+    // the LEDs lit, as an LED_REG mask
+    Uint16 getLEDs(void);
+
+    // segments lit on a digit, 0-7 from the left: a-g and dp in bits 0-7
+    Uint16 getSegments(Uint16 digit);
+
+    // the display as text, with a '.' after each digit whose point is lit,
+    // '?' for a pattern that isn't a character, and digits rather than the
+    // letters O and S; <text> holds TM1638_TEXT_SIZE characters
+    void getText(char *text);
+
+    // does the display show <text>: eight characters from 0-9, A-Z, '-'
+    // and ' ', each optionally followed by '.'
+    bool shows(const char *text);
+
+    // bytes clocked in, and bytes the chip could not make sense of
+    Uint32 getBytes(void);
+    Uint32 getErrors(void);
+    void clearCounts(void);
+};
+
+
+#endif // __TM1638_EMULATOR_H